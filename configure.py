@@ -319,8 +319,7 @@ if platform.is_msvc():
               # We never have strings or arrays larger than 2**31.
               '/wd4267',
               '/DNOMINMAX', '/D_CRT_SECURE_NO_WARNINGS',
-              '/D_HAS_EXCEPTIONS=0',
-              '/DNINJA_PYTHON="%s"' % options.with_python]
+              '/D_HAS_EXCEPTIONS=0']
     if platform.msvc_needs_fs():
         cflags.append('/FS')
     ldflags = ['/DEBUG', '/libpath:$builddir']
@@ -334,8 +333,7 @@ else:
               '-Wno-unused-parameter',
               '-fno-rtti',
               '-fno-exceptions',
-              '-fvisibility=hidden', '-pipe',
-              '-DNINJA_PYTHON="%s"' % options.with_python]
+              '-fvisibility=hidden', '-pipe']
     if options.debug:
         cflags += ['-D_GLIBCXX_DEBUG', '-D_GLIBCXX_DEBUG_PEDANTIC']
         cflags.remove('-fno-rtti')  # Needed for above pedanticness.
@@ -388,7 +386,7 @@ def shell_escape(str):
     """Escape str such that it's interpreted as a single argument by
     the shell."""
 
-    # This isn't complete, but it's just enough to make NINJA_PYTHON work.
+    # This isn't complete, but it's just enough for the flags we pass.
     if platform.is_windows():
       return str
     if '"' in str:
@@ -448,16 +446,7 @@ n.newline()
 objs = []
 
 if platform.supports_ninja_browse():
-    n.comment('browse_py.h is used to inline browse.py.')
-    n.rule('inline',
-           command='"%s"' % src('inline.sh') + ' $varname < $in > $out',
-           description='INLINE $out')
-    n.build(built('browse_py.h'), 'inline', src('browse.py'),
-            implicit=src('inline.sh'),
-            variables=[('varname', 'kBrowsePy')])
-    n.newline()
-
-    objs += cxx('browse', order_only=built('browse_py.h'))
+    objs += cxx('browse')
     n.newline()
 
 n.comment('the depfile parser and ninja lexers are generated using re2c.')
@@ -492,10 +481,12 @@ for name in ['build',
              'eval_env',
              'graph',
              'graphviz',
+             'json',
              'lexer',
              'line_printer',
              'manifest_parser',
              'metrics',
+             'query',
              'state',
              'string_piece_util',
              'util',
@@ -555,16 +546,24 @@ for name in ['build_log_test',
              'deps_log_test',
              'disk_interface_test',
              'edit_distance_test',
+             'eval_env_test',
              'graph_test',
+             'graphviz_test',
+             'json_test',
              'lexer_test',
+             'line_printer_test',
              'manifest_parser_test',
+             'metrics_test',
              'ninja_test',
+             'query_test',
              'state_test',
              'string_piece_util_test',
              'subprocess_test',
              'test',
              'util_test']:
     objs += cxx(name)
+if platform.supports_ninja_browse():
+    objs += cxx('browse_test')
 if platform.is_windows():
     for name in ['includes_normalize_test', 'msvc_helper_test']:
         objs += cxx(name)
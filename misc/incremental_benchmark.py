@@ -0,0 +1,239 @@
+#!/usr/bin/env python
+
+# Copyright 2018 Google Inc. All Rights Reserved.
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Benchmarks no-op and incremental builds of a large synthetic project.
+
+The project is generated with write_fake_manifests.py and built once with a
+fake compiler that writes depfiles, so .ninja_log and .ninja_deps look like
+the ones of a real build.  Then ninja is timed in a few scenarios:
+
+  noop          nothing changed
+  touch_source  one source file changed
+  touch_header  the most widely included header changed
+
+The incremental scenarios run with -n, so they measure how long ninja takes
+to decide what to do (parse, log load, dependency scan, plan) and not the
+commands.  The per-phase times and process counters reported by -d stats
+are recorded as well.
+
+Usage:
+  python misc/incremental_benchmark.py ./ninja -o results.json
+  python misc/incremental_benchmark.py ./ninja --baseline results.json
+
+With --baseline, exits with status 1 if any scenario got slower than the
+baseline by more than --max-regression.
+"""
+
+from __future__ import print_function
+
+import argparse
+import json
+import os
+import random
+import subprocess
+import sys
+import time
+
+import write_fake_manifests
+
+# Stands in for the compiler, archiver and linker: writes the depfile the
+# compiler would write, based on the #include lines of the source, and
+# touches the output.
+FAKE_TOOL = r'''#!/bin/sh
+while [ $# -gt 0 ]; do
+  case "$1" in
+    -MF) depfile=$2; shift ;;
+    -c) src=$2; shift ;;
+    -o) out=$2; shift ;;
+  esac
+  shift
+done
+if [ -n "$depfile" ]; then
+  dir=$(dirname "$src")
+  {
+    printf '%s: %s' "$out" "$src"
+    sed -n 's/^#include "\(.*\)"$/\1/p' "$src" | while read h; do
+      case "$h" in
+        */*) printf ' src/%s' "$h" ;;
+        *) printf ' %s/%s' "$dir" "$h" ;;
+      esac
+    done
+    echo
+  } > "$depfile"
+fi
+touch "$out"
+'''
+
+
+def generate(outdir, num_targets, seed):
+    """Writes the manifests and sources, with tools replaced by FAKE_TOOL."""
+    random.seed(seed)
+    targets = write_fake_manifests.random_targets(num_targets, 'src')
+    for target in targets:
+        path = os.path.join(outdir, target.ninja_file_path)
+        with write_fake_manifests.FileWriter(path) as n:
+            write_fake_manifests.write_target_ninja(n, target, 'src')
+        write_fake_manifests.write_sources(target, outdir)
+
+    tool = os.path.join(outdir, 'fake_tool.sh')
+    with open(tool, 'w') as f:
+        f.write(FAKE_TOOL)
+    os.chmod(tool, 0o755)
+
+    path = os.path.join(outdir, 'build.ninja')
+    with write_fake_manifests.FileWriter(path) as master_ninja:
+        master_ninja.width = 120
+        master_ninja.variable('fake_tool', './fake_tool.sh')
+        write_fake_manifests.write_master_ninja(master_ninja, targets)
+    with open(path) as f:
+        lines = f.read().splitlines(True)
+    with open(path, 'w') as f:
+        for line in lines:
+            if line.split(' = ')[0] in ('cxx', 'ld', 'alink'):
+                line = line.split(' = ')[0] + ' = $fake_tool\n'
+            f.write(line)
+
+
+def most_included_header(outdir):
+    """Returns the header included by the most sources."""
+    counts = {}
+    src_root = os.path.join(outdir, 'src')
+    for dirpath, _, filenames in os.walk(src_root):
+        for name in filenames:
+            if not name.endswith('.cc'):
+                continue
+            with open(os.path.join(dirpath, name)) as f:
+                for line in f:
+                    if not line.startswith('#include "'):
+                        continue
+                    header = line[len('#include "'):].rstrip().rstrip('"')
+                    if '/' in header:
+                        header = os.path.join(src_root, header)
+                    else:
+                        header = os.path.join(dirpath, header)
+                    counts[header] = counts.get(header, 0) + 1
+    return max(sorted(counts), key=lambda h: counts[h])
+
+
+def first_source(outdir):
+    for dirpath, dirnames, filenames in os.walk(os.path.join(outdir, 'src')):
+        dirnames.sort()
+        for name in sorted(filenames):
+            if name.endswith('.cc'):
+                return os.path.join(dirpath, name)
+
+
+def parse_stats(output):
+    """Returns the -d stats=json report at the end of ninja's output."""
+    return json.loads(output.splitlines()[-1])
+
+
+def measure(ninja, outdir, args, repeat):
+    """Runs ninja |repeat| times, returns the timings of the fastest run."""
+    best = None
+    total = 0
+    for _ in range(repeat):
+        start = time.time()
+        output = subprocess.check_output([ninja, '-d', 'stats=json'] + args,
+                                         cwd=outdir)
+        dt = (time.time() - start) * 1000
+        total += dt
+        if best is None or dt < best['best_ms']:
+            stats = parse_stats(output.decode('utf-8', 'replace'))
+            best = {'best_ms': dt,
+                    'phases': dict((m['name'], m['total_us'] / 1000.0)
+                                   for m in stats['metrics']),
+                    'counters': stats['counters']}
+    best['mean_ms'] = total / repeat
+    return best
+
+
+def measure_touched(ninja, outdir, path, repeat):
+    """Measures a dry run after touching |path|, then restores its mtime."""
+    st = os.stat(path)
+    os.utime(path, (st.st_atime, time.time() + 10))
+    try:
+        return measure(ninja, outdir, ['-n'], repeat)
+    finally:
+        os.utime(path, (st.st_atime, st.st_mtime))
+
+
+def main():
+    parser = argparse.ArgumentParser()
+    parser.add_argument('ninja', help='ninja binary to benchmark')
+    parser.add_argument('-d', '--dir', default='incremental_benchmark',
+                        help='directory for the generated project; it is '
+                             'only generated and built if it has no '
+                             'build.ninja yet')
+    parser.add_argument('-t', '--targets', type=int, default=1500,
+                        help='number of targets (default: 1500)')
+    parser.add_argument('-S', '--seed', type=int, default=12345,
+                        help='random seed')
+    parser.add_argument('-r', '--repeat', type=int, default=5,
+                        help='runs per scenario (default: 5)')
+    parser.add_argument('-o', '--output', help='write results as JSON here')
+    parser.add_argument('--baseline', help='JSON results to compare against')
+    parser.add_argument('--max-regression', type=float, default=0.1,
+                        help='allowed slowdown relative to the baseline '
+                             '(default: 0.1)')
+    args = parser.parse_args()
+
+    ninja = os.path.abspath(args.ninja)
+    outdir = args.dir
+    if not os.path.exists(os.path.join(outdir, 'build.ninja')):
+        print('generating %d targets in %s' % (args.targets, outdir))
+        generate(outdir, args.targets, args.seed)
+        print('initial build')
+        with open(os.devnull, 'w') as devnull:
+            subprocess.check_call([ninja, '-C', outdir], stdout=devnull)
+
+    results = {'targets': args.targets, 'scenarios': {}}
+    scenarios = results['scenarios']
+    scenarios['noop'] = measure(ninja, outdir, [], args.repeat)
+    scenarios['touch_source'] = measure_touched(
+        ninja, outdir, first_source(outdir), args.repeat)
+    scenarios['touch_header'] = measure_touched(
+        ninja, outdir, most_included_header(outdir), args.repeat)
+
+    for name in sorted(scenarios):
+        s = scenarios[name]
+        print('%-13s best %7.1fms  mean %7.1fms' % (name, s['best_ms'],
+                                                    s['mean_ms']))
+        for phase in sorted(s['phases']):
+            print('  %-24s %8.1fms' % (phase, s['phases'][phase]))
+
+    if args.output:
+        with open(args.output, 'w') as f:
+            json.dump(results, f, indent=2, sort_keys=True)
+
+    if args.baseline:
+        with open(args.baseline) as f:
+            baseline = json.load(f)['scenarios']
+        regressed = False
+        for name in sorted(scenarios):
+            if name not in baseline:
+                continue
+            old, new = baseline[name]['best_ms'], scenarios[name]['best_ms']
+            if new > old * (1 + args.max_regression):
+                print('%s regressed: %.1fms -> %.1fms' % (name, old, new))
+                regressed = True
+        if regressed:
+            return 1
+    return 0
+
+
+if __name__ == '__main__':
+    sys.exit(main())
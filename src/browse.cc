@@ -12,62 +12,530 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#ifndef __STDC_FORMAT_MACROS
+#define __STDC_FORMAT_MACROS
+#endif
+
 #include "browse.h"
 
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <netdb.h>
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
 #include <unistd.h>
-#include <vector>
 
-#include "build/browse_py.h"
+#include <algorithm>
+#include <set>
 
-void RunBrowsePython(State* state, const char* ninja_command,
-                     const char* input_file, int argc, char* argv[]) {
-  // Fork off a Python process and have it run our code via its stdin.
-  // (Actually the Python process becomes the parent.)
-  int pipefd[2];
-  if (pipe(pipefd) < 0) {
-    perror("ninja: pipe");
-    return;
+#include "build_log.h"
+#include "deps_log.h"
+#include "graph.h"
+#include "json.h"
+#include "state.h"
+#include "util.h"
+
+namespace {
+
+/// How long a client may take to send its request or read the response.
+const int kClientTimeoutSeconds = 10;
+
+const char kPageHeader[] =
+"<!DOCTYPE html>\n"
+"<style>\n"
+"body {\n"
+"    font-family: sans;\n"
+"    font-size: 0.8em;\n"
+"    margin: 4ex;\n"
+"}\n"
+"h1 {\n"
+"    font-weight: normal;\n"
+"    font-size: 140%;\n"
+"    text-align: center;\n"
+"    margin: 0;\n"
+"}\n"
+"h2 {\n"
+"    font-weight: normal;\n"
+"    font-size: 120%;\n"
+"}\n"
+"tt {\n"
+"    font-family: WebKitHack, monospace;\n"
+"    white-space: nowrap;\n"
+"}\n"
+".filelist {\n"
+"  -webkit-columns: auto 2;\n"
+"}\n"
+"</style>\n";
+
+string HTMLEscape(const string& text) {
+  string result;
+  for (string::const_iterator c = text.begin(); c != text.end(); ++c) {
+    switch (*c) {
+      case '&': result += "&amp;"; break;
+      case '<': result += "&lt;"; break;
+      case '>': result += "&gt;"; break;
+      case '"': result += "&quot;"; break;
+      case '\'': result += "&#x27;"; break;
+      default: result += *c; break;
+    }
+  }
+  return result;
+}
+
+int HexValue(char c) {
+  if (c >= '0' && c <= '9')
+    return c - '0';
+  if (c >= 'a' && c <= 'f')
+    return c - 'a' + 10;
+  if (c >= 'A' && c <= 'F')
+    return c - 'A' + 10;
+  return -1;
+}
+
+/// Decode %XX escapes in a URL component.
+string URLDecode(const string& text) {
+  string result;
+  for (size_t i = 0; i < text.size(); ++i) {
+    if (text[i] == '%' && i + 2 < text.size() &&
+        HexValue(text[i + 1]) >= 0 && HexValue(text[i + 2]) >= 0) {
+      result += (char)(HexValue(text[i + 1]) * 16 + HexValue(text[i + 2]));
+      i += 2;
+    } else {
+      result += text[i];
+    }
+  }
+  return result;
+}
+
+/// Encode a path for use as the query part of a URL.
+string URLEncode(const string& text) {
+  static const char kHexDigits[] = "0123456789ABCDEF";
+  string result;
+  for (string::const_iterator i = text.begin(); i != text.end(); ++i) {
+    unsigned char c = *i;
+    if (isalnum(c) || strchr("/._-~+,:@", c)) {
+      result += c;
+    } else {
+      result += '%';
+      result += kHexDigits[c >> 4];
+      result += kHexDigits[c & 0xf];
+    }
+  }
+  return result;
+}
+
+BrowseResponse HTMLResponse(int status, const string& body) {
+  BrowseResponse response;
+  response.status = status;
+  response.content_type = "text/html; charset=utf-8";
+  response.body = kPageHeader + body;
+  return response;
+}
+
+BrowseResponse JSONResponse(int status, const string& body) {
+  BrowseResponse response;
+  response.status = status;
+  response.content_type = "application/json";
+  response.body = body + "\n";
+  return response;
+}
+
+BrowseResponse JSONError(int status, const string& message) {
+  string body = "{\"error\": \"";
+  EncodeJSONString(message, &body);
+  body += "\"}";
+  return JSONResponse(status, body);
+}
+
+const char* StatusText(int status) {
+  switch (status) {
+    case 200: return "OK";
+    case 302: return "Found";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    default: return "Error";
+  }
+}
+
+bool WriteAll(int fd, const string& data) {
+  size_t written = 0;
+  while (written < data.size()) {
+    ssize_t len = write(fd, data.data() + written, data.size() - written);
+    if (len < 0) {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+    written += len;
+  }
+  return true;
+}
+
+/// Read an HTTP request from \a fd and answer it.
+void HandleConnection(BrowseServer* server, int fd) {
+  // Only the request line is needed, but read the whole header so that the
+  // client doesn't see a reset when the socket is closed.
+  string request;
+  char buf[4096];
+  while (request.find("\r\n\r\n") == string::npos &&
+         request.size() < 64 * 1024) {
+    ssize_t len = read(fd, buf, sizeof(buf));
+    if (len < 0 && errno == EINTR)
+      continue;
+    if (len <= 0)
+      break;
+    request.append(buf, len);
+  }
+
+  BrowseResponse response;
+  size_t method_end = request.find(' ');
+  size_t url_end = request.find(' ', method_end + 1);
+  if (method_end == string::npos || url_end == string::npos) {
+    response.status = 400;
+  } else if (request.compare(0, method_end, "GET") != 0) {
+    response.status = 405;
+  } else {
+    response = server->HandleRequest(
+        request.substr(method_end + 1, url_end - method_end - 1));
   }
 
+  char status_line[64];
+  snprintf(status_line, sizeof(status_line), "HTTP/1.0 %d %s\r\n",
+           response.status, StatusText(response.status));
+  string header = status_line;
+  if (!response.content_type.empty())
+    header += "Content-Type: " + response.content_type + "\r\n";
+  if (!response.location.empty())
+    header += "Location: " + response.location + "\r\n";
+  char length[64];
+  snprintf(length, sizeof(length), "Content-Length: %d\r\n",
+           (int)response.body.size());
+  header += length;
+  header += "Connection: close\r\n\r\n";
+  if (WriteAll(fd, header))
+    WriteAll(fd, response.body);
+}
+
+/// Point the user's web browser at \a url, without waiting for it.
+void OpenBrowser(const string& url) {
+#ifdef __APPLE__
+  const char* command = "open";
+#else
+  const char* command = "xdg-open";
+#endif
+  // Fork twice, so that the browser is reparented to init, which reaps it;
+  // only the short-lived intermediate child needs to be waited for here.
   pid_t pid = fork();
-  if (pid < 0) {
-    perror("ninja: fork");
+  if (pid < 0)
     return;
+  if (pid > 0) {
+    while (waitpid(pid, NULL, 0) < 0 && errno == EINTR) {}
+    return;
+  }
+  if (fork() != 0)
+    _exit(0);
+  // Keep the browser's chatter out of our output.
+  int null_fd = open("/dev/null", O_WRONLY);
+  if (null_fd >= 0) {
+    dup2(null_fd, 1);
+    dup2(null_fd, 2);
   }
+  execlp(command, command, url.c_str(), (char*)NULL);
+  _exit(1);
+}
 
-  if (pid > 0) {  // Parent.
-    close(pipefd[1]);
-    do {
-      if (dup2(pipefd[0], 0) < 0) {
-        perror("ninja: dup2");
-        break;
-      }
+}  // namespace
+
+BrowseServer::BrowseServer(State* state, BuildLog* build_log,
+                           DepsLog* deps_log, const string& initial_target)
+    : state_(state), build_log_(build_log), deps_log_(deps_log),
+      initial_target_(initial_target), query_(deps_log) {}
+
+BrowseResponse BrowseServer::HandleRequest(const string& url) {
+  string page = url;
+  string query;
+  size_t question = url.find('?');
+  if (question != string::npos) {
+    page = url.substr(0, question);
+    query = URLDecode(url.substr(question + 1));
+  }
 
-      std::vector<const char *> command;
-      command.push_back(NINJA_PYTHON);
-      command.push_back("-");
-      command.push_back("--ninja-command");
-      command.push_back(ninja_command);
-      command.push_back("-f");
-      command.push_back(input_file);
-      for (int i = 0; i < argc; i++) {
-          command.push_back(argv[i]);
+  if (page == "/" && question == string::npos) {
+    BrowseResponse response;
+    response.status = 302;
+    response.location = "/?" + URLEncode(initial_target_);
+    return response;
+  }
+  if (page == "/")
+    return NodePage(query);
+  if (page == "/api/node")
+    return NodeJSON(query);
+  if (page == "/api/edge")
+    return EdgeJSON(query);
+  if (page == "/api/dependents")
+    return DependentsJSON(query);
+  if (page == "/api/timing")
+    return TimingJSON(query);
+  return HTMLResponse(404, "<h1>not found</h1>");
+}
+
+Node* BrowseServer::LookupNode(const string& path, string* err) {
+  string canonical = path;
+  uint64_t slash_bits;
+  if (!CanonicalizePath(&canonical, &slash_bits, err))
+    return NULL;
+  Node* node = state_->LookupNode(canonical);
+  if (!node)
+    *err = "unknown path '" + path + "'";
+  return node;
+}
+
+BrowseResponse BrowseServer::NodePage(const string& path) {
+  string err;
+  Node* node = LookupNode(path, &err);
+  if (!node)
+    return HTMLResponse(404, "<h1><tt>" + HTMLEscape(err) + "</tt></h1>");
+
+  string body = "<h1><tt>" + HTMLEscape(node->path()) + "</tt></h1>\n";
+  if (Edge* edge = node->in_edge()) {
+    body += "<h2>target is built using rule <tt>" +
+        HTMLEscape(edge->rule().name()) + "</tt> of</h2>\n";
+    set<pair<string, string> > inputs;
+    for (size_t i = 0; i < edge->inputs_.size(); ++i) {
+      string type;
+      if (edge->is_implicit(i) || edge->is_order_only(i))
+        type = string(" (") + InputType(edge, i) + ")";
+      inputs.insert(make_pair(edge->inputs_[i]->path(), type));
+    }
+    if (!inputs.empty()) {
+      body += "<div class=filelist>\n";
+      for (set<pair<string, string> >::iterator i = inputs.begin();
+           i != inputs.end(); ++i) {
+        body += "<tt><a href=\"?" + HTMLEscape(URLEncode(i->first)) + "\">" +
+            HTMLEscape(i->first) + "</a>" + i->second + "</tt><br>\n";
       }
-      command.push_back(NULL);
-      execvp(command[0], (char**)&command[0]);
-      perror("ninja: execvp");
-    } while (false);
-    _exit(1);
-  } else {  // Child.
-    close(pipefd[0]);
-
-    // Write the script file into the stdin of the Python process.
-    ssize_t len = write(pipefd[1], kBrowsePy, sizeof(kBrowsePy));
-    if (len < (ssize_t)sizeof(kBrowsePy))
-      perror("ninja: write");
-    close(pipefd[1]);
-    exit(0);
+      body += "</div>\n";
+    }
+  }
+
+  // A node can be used by several edges; rather than showing each, show the
+  // union of their outputs.
+  set<string> outputs;
+  for (vector<Edge*>::const_iterator e = node->out_edges().begin();
+       e != node->out_edges().end(); ++e) {
+    for (vector<Node*>::iterator out = (*e)->outputs_.begin();
+         out != (*e)->outputs_.end(); ++out) {
+      outputs.insert((*out)->path());
+    }
+  }
+  if (!outputs.empty()) {
+    body += "<h2>dependent edges build:</h2>\n<div class=filelist>\n";
+    for (set<string>::iterator i = outputs.begin(); i != outputs.end(); ++i) {
+      body += "<tt><a href=\"?" + HTMLEscape(URLEncode(*i)) + "\">" +
+          HTMLEscape(*i) + "</a></tt><br>\n";
+    }
+    body += "</div>\n";
+  }
+  return HTMLResponse(200, body);
+}
+
+BrowseResponse BrowseServer::NodeJSON(const string& path) {
+  string err;
+  Node* node = LookupNode(path, &err);
+  if (!node)
+    return JSONError(404, err);
+
+  string body = "{\"path\": \"";
+  EncodeJSONString(node->path(), &body);
+  body += "\", \"in_edge\": ";
+  if (Edge* edge = node->in_edge()) {
+    char id[32];
+    snprintf(id, sizeof(id), "%d", (int)edge->id_);
+    body += id;
+  } else {
+    body += "null";
+  }
+  body += ", \"out_edges\": [";
+  for (vector<Edge*>::const_iterator e = node->out_edges().begin();
+       e != node->out_edges().end(); ++e) {
+    char id[32];
+    snprintf(id, sizeof(id), "%s%d", e == node->out_edges().begin() ? "" : ", ",
+             (int)(*e)->id_);
+    body += id;
+  }
+  body += "], \"deps\": ";
+  if (deps_log_->GetDeps(node))
+    AppendJSONPaths(query_.DiscoveredInputs(node), &body);
+  else
+    body += "null";
+  body += "}";
+  return JSONResponse(200, body);
+}
+
+BrowseResponse BrowseServer::EdgeJSON(const string& id_text) {
+  char* end;
+  long id = strtol(id_text.c_str(), &end, 10);
+  if (id_text.empty() || *end != '\0' || id < 0 ||
+      id >= (long)state_->edges_.size()) {
+    return JSONError(404, "unknown edge '" + id_text + "'");
+  }
+  Edge* edge = state_->edges_[id];
+
+  char id_json[32];
+  snprintf(id_json, sizeof(id_json), "%ld", id);
+  string body = string("{\"id\": ") + id_json + ", \"rule\": \"";
+  EncodeJSONString(edge->rule().name(), &body);
+  body += "\", \"command\": \"";
+  EncodeJSONString(edge->EvaluateCommand(), &body);
+  body += "\", \"inputs\": [";
+  for (size_t i = 0; i < edge->inputs_.size(); ++i) {
+    if (i != 0)
+      body += ", ";
+    body += "{\"path\": \"";
+    EncodeJSONString(edge->inputs_[i]->path(), &body);
+    body += "\", \"type\": \"";
+    body += InputType(edge, i);
+    body += "\"}";
+  }
+  body += "], \"outputs\": [";
+  for (size_t i = 0; i < edge->outputs_.size(); ++i) {
+    if (i != 0)
+      body += ", ";
+    body += "{\"path\": \"";
+    EncodeJSONString(edge->outputs_[i]->path(), &body);
+    body += "\", \"type\": \"";
+    body += edge->is_implicit_out(i) ? "implicit" : "explicit";
+    body += "\"}";
+  }
+  body += "]}";
+  return JSONResponse(200, body);
+}
+
+BrowseResponse BrowseServer::DependentsJSON(const string& path) {
+  string err;
+  Node* node = LookupNode(path, &err);
+  if (!node)
+    return JSONError(404, err);
+
+  set<Node*> outputs;
+  for (vector<Edge*>::const_iterator e = node->out_edges().begin();
+       e != node->out_edges().end(); ++e) {
+    outputs.insert((*e)->outputs_.begin(), (*e)->outputs_.end());
+  }
+  const vector<Node*>& discovered = query_.DiscoveredOutputs(node);
+
+  string body = "{\"path\": \"";
+  EncodeJSONString(node->path(), &body);
+  body += "\", \"outputs\": ";
+  AppendJSONPaths(vector<Node*>(outputs.begin(), outputs.end()), &body);
+  body += ", \"deps_log\": ";
+  AppendJSONPaths(discovered, &body);
+  body += "}";
+  return JSONResponse(200, body);
+}
+
+BrowseResponse BrowseServer::TimingJSON(const string& path) {
+  string err;
+  Node* node = LookupNode(path, &err);
+  if (!node)
+    return JSONError(404, err);
+  BuildLog::LogEntry* entry = build_log_->LookupByOutput(node->path());
+  if (!entry)
+    return JSONError(404, "'" + node->path() + "' is not in the build log");
+
+  string body = "{\"path\": \"";
+  EncodeJSONString(node->path(), &body);
+  char buf[256];
+  snprintf(buf, sizeof(buf),
+           "\", \"start_ms\": %d, \"end_ms\": %d, \"duration_ms\": %d, "
+           "\"mtime\": %" PRId64 ", \"command_hash\": \"%" PRIx64 "\"}",
+           entry->start_time, entry->end_time,
+           entry->end_time - entry->start_time, entry->mtime,
+           entry->command_hash);
+  body += buf;
+  return JSONResponse(200, body);
+}
+
+bool BrowseServer::Serve(const string& hostname, int port, bool open_browser) {
+  // A client going away mid-response must not kill the server.
+  signal(SIGPIPE, SIG_IGN);
+
+  struct addrinfo hints;
+  memset(&hints, 0, sizeof(hints));
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = AI_PASSIVE;
+  char port_text[16];
+  snprintf(port_text, sizeof(port_text), "%d", port);
+  struct addrinfo* addrs;
+  int ret = getaddrinfo(hostname.empty() ? NULL : hostname.c_str(), port_text,
+                        &hints, &addrs);
+  if (ret != 0) {
+    Error("%s: %s", hostname.c_str(), gai_strerror(ret));
+    return false;
+  }
+
+  int fd = -1;
+  int bind_errno = 0;
+  for (struct addrinfo* addr = addrs; addr; addr = addr->ai_next) {
+    fd = socket(addr->ai_family, addr->ai_socktype, addr->ai_protocol);
+    if (fd < 0)
+      continue;
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(fd, addr->ai_addr, addr->ai_addrlen) == 0 && listen(fd, 16) == 0)
+      break;
+    bind_errno = errno;
+    close(fd);
+    fd = -1;
+  }
+  freeaddrinfo(addrs);
+  if (fd < 0) {
+    Error("cannot listen on %s:%d: %s", hostname.c_str(), port,
+          strerror(bind_errno));
+    return false;
+  }
+
+  string display_host = hostname;
+  if (display_host.empty()) {
+    char name[256];
+    if (gethostname(name, sizeof(name)) == 0)
+      display_host = name;
+  }
+  printf("Web server running on %s:%d, ctl-C to abort...\n",
+         display_host.c_str(), port);
+  fflush(stdout);
+  if (open_browser) {
+    char url[512];
+    snprintf(url, sizeof(url), "http://%s:%d", display_host.c_str(), port);
+    OpenBrowser(url);
+  }
+
+  for (;;) {
+    int client = accept(fd, NULL, NULL);
+    if (client < 0) {
+      if (errno == EINTR || errno == ECONNABORTED)
+        continue;
+      Error("accept: %s", strerror(errno));
+      close(fd);
+      return false;
+    }
+    // Don't let a client that stops sending or reading hang the server.
+    struct timeval timeout;
+    timeout.tv_sec = kClientTimeoutSeconds;
+    timeout.tv_usec = 0;
+    setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    setsockopt(client, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    HandleConnection(this, client);
+    close(client);
   }
 }
@@ -15,14 +15,67 @@
 #ifndef NINJA_BROWSE_H_
 #define NINJA_BROWSE_H_
 
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "query.h"
+
+struct BuildLog;
+struct DepsLog;
+struct Edge;
+struct Node;
 struct State;
 
-/// Run in "browse" mode, which execs a Python webserver.
-/// \a ninja_command is the command used to invoke ninja.
-/// \a args are the number of arguments to be passed to the Python script.
-/// \a argv are arguments to be passed to the Python script.
-/// This function does not return if it runs successfully.
-void RunBrowsePython(State* state, const char* ninja_command,
-                     const char* input_file, int argc, char* argv[]);
+/// A response of the browse server.
+struct BrowseResponse {
+  BrowseResponse() : status(200) {}
+
+  int status;
+  string content_type;
+  /// Target of a redirect, if status is 302.
+  string location;
+  string body;
+};
+
+/// Web server for browsing the dependency graph, which answers from the
+/// already loaded state and logs.
+///
+/// Pages:
+///   /?PATH                 HTML view of the node PATH
+/// JSON endpoints:
+///   /api/node?PATH         the node PATH, its in edge, out edges and deps
+///   /api/edge?ID           the edge with id ID, its inputs and outputs
+///   /api/dependents?PATH   edges using PATH, and outputs whose deps log
+///                          entries list PATH
+///   /api/timing?PATH       the build log entry of PATH
+struct BrowseServer {
+  BrowseServer(State* state, BuildLog* build_log, DepsLog* deps_log,
+               const string& initial_target);
+
+  /// Answer a GET request for \a url.
+  BrowseResponse HandleRequest(const string& url);
+
+  /// Listen on \a hostname:\a port and answer requests until killed,
+  /// optionally pointing a web browser at the server first.
+  /// @return false on error, after printing it.
+  bool Serve(const string& hostname, int port, bool open_browser);
+
+ private:
+  BrowseResponse NodePage(const string& path);
+  BrowseResponse NodeJSON(const string& path);
+  BrowseResponse EdgeJSON(const string& id);
+  BrowseResponse DependentsJSON(const string& path);
+  BrowseResponse TimingJSON(const string& path);
+
+  /// Look up the node for a path as typed by the user.
+  Node* LookupNode(const string& path, string* err);
+
+  State* state_;
+  BuildLog* build_log_;
+  DepsLog* deps_log_;
+  string initial_target_;
+  GraphQuery query_;
+};
 
 #endif  // NINJA_BROWSE_H_
@@ -0,0 +1,125 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "browse.h"
+
+#include <unistd.h>
+
+#include "build_log.h"
+#include "deps_log.h"
+#include "graph.h"
+#include "test.h"
+
+namespace {
+
+const char kTestFilename[] = "BrowseTest-tempfile";
+
+struct BrowseTest : public StateTestWithBuiltinRules {
+  virtual void SetUp() {
+    unlink(kTestFilename);
+    ASSERT_NO_FATAL_FAILURE(AssertParse(&state_,
+"rule cc\n"
+"  command = cc -c $in -o $out\n"
+"build foo.o: cc foo.c | foo.h || gen\n"
+"build foo: cat foo.o\n"
+"build gen: phony\n"));
+  }
+  virtual void TearDown() {
+    deps_log_.Close();
+    unlink(kTestFilename);
+  }
+
+  BuildLog build_log_;
+  DepsLog deps_log_;
+};
+
+TEST_F(BrowseTest, Redirect) {
+  BrowseServer server(&state_, &build_log_, &deps_log_, "foo bar");
+  BrowseResponse response = server.HandleRequest("/");
+  EXPECT_EQ(302, response.status);
+  EXPECT_EQ("/?foo%20bar", response.location);
+}
+
+TEST_F(BrowseTest, NodePage) {
+  BrowseServer server(&state_, &build_log_, &deps_log_, "all");
+  BrowseResponse response = server.HandleRequest("/?foo%2eo");
+  EXPECT_EQ(200, response.status);
+  EXPECT_NE(string::npos, response.body.find("<h1><tt>foo.o</tt></h1>"));
+  EXPECT_NE(string::npos, response.body.find("rule <tt>cc</tt>"));
+  EXPECT_NE(string::npos, response.body.find(">foo.h</a> (implicit)"));
+  EXPECT_NE(string::npos, response.body.find(">gen</a> (order-only)"));
+  EXPECT_NE(string::npos, response.body.find("<a href=\"?foo\">foo</a>"));
+
+  response = server.HandleRequest("/?nonexistent");
+  EXPECT_EQ(404, response.status);
+  EXPECT_NE(string::npos, response.body.find("unknown path"));
+
+  EXPECT_EQ(404, server.HandleRequest("/other").status);
+}
+
+TEST_F(BrowseTest, EdgeAndNodeJSON) {
+  BrowseServer server(&state_, &build_log_, &deps_log_, "all");
+  Node* node = GetNode("foo.o");
+  char url[64];
+  snprintf(url, sizeof(url), "/api/edge?%d", (int)node->in_edge()->id_);
+  BrowseResponse response = server.HandleRequest(url);
+  EXPECT_EQ(200, response.status);
+  EXPECT_EQ("application/json", response.content_type);
+  EXPECT_NE(string::npos,
+            response.body.find("\"command\": \"cc -c foo.c -o foo.o\""));
+  EXPECT_NE(string::npos, response.body.find(
+      "{\"path\": \"gen\", \"type\": \"order-only\"}"));
+
+  response = server.HandleRequest("/api/node?foo.o");
+  EXPECT_EQ(200, response.status);
+  EXPECT_NE(string::npos, response.body.find("\"deps\": null"));
+
+  // The id is echoed as parsed, so the response stays valid JSON.
+  snprintf(url, sizeof(url), "/api/edge?+%d", (int)node->in_edge()->id_);
+  response = server.HandleRequest(url);
+  EXPECT_EQ(200, response.status);
+  snprintf(url, sizeof(url), "{\"id\": %d,", (int)node->in_edge()->id_);
+  EXPECT_EQ(0u, response.body.find(url));
+
+  EXPECT_EQ(404, server.HandleRequest("/api/edge?12345").status);
+  EXPECT_EQ(404, server.HandleRequest("/api/edge?x").status);
+  EXPECT_EQ(404, server.HandleRequest("/api/node?nonexistent").status);
+}
+
+TEST_F(BrowseTest, DependentsAndTiming) {
+  string err;
+  ASSERT_TRUE(deps_log_.OpenForWrite(kTestFilename, &err));
+  vector<Node*> deps;
+  deps.push_back(state_.GetNode("foo.h", 0));
+  deps.push_back(state_.GetNode("bar.h", 0));
+  ASSERT_TRUE(deps_log_.RecordDeps(GetNode("foo.o"), 1, deps));
+  build_log_.RecordCommand(GetNode("foo.o")->in_edge(), 10, 25, 0);
+
+  BrowseServer server(&state_, &build_log_, &deps_log_, "all");
+  BrowseResponse response = server.HandleRequest("/api/dependents?bar.h");
+  EXPECT_EQ(200, response.status);
+  EXPECT_EQ("{\"path\": \"bar.h\", \"outputs\": [], \"deps_log\": [\"foo.o\"]}\n",
+            response.body);
+
+  response = server.HandleRequest("/api/node?foo.o");
+  EXPECT_NE(string::npos,
+            response.body.find("\"deps\": [\"foo.h\", \"bar.h\"]"));
+
+  response = server.HandleRequest("/api/timing?foo.o");
+  EXPECT_EQ(200, response.status);
+  EXPECT_NE(string::npos, response.body.find("\"duration_ms\": 15"));
+  EXPECT_EQ(404, server.HandleRequest("/api/timing?foo").status);
+}
+
+}  // namespace
@@ -19,7 +19,6 @@
 #include <limits.h>
 #include <stdio.h>
 #include <stdlib.h>
-#include <functional>
 
 #ifdef _WIN32
 #include <fcntl.h>
@@ -37,6 +36,7 @@
 #include "deps_log.h"
 #include "disk_interface.h"
 #include "graph.h"
+#include "metrics.h"
 #include "state.h"
 #include "subprocess.h"
 #include "util.h"
@@ -49,7 +49,7 @@ struct DryRunCommandRunner : public CommandRunner {
 
   // Overridden from CommandRunner:
   virtual bool CanRunMore();
-  virtual bool StartCommand(Edge* edge);
+  virtual bool StartCommand(Edge* edge, const string& command);
   virtual bool WaitForCommand(Result* result);
 
  private:
@@ -60,7 +60,7 @@ bool DryRunCommandRunner::CanRunMore() {
   return true;
 }
 
-bool DryRunCommandRunner::StartCommand(Edge* edge) {
+bool DryRunCommandRunner::StartCommand(Edge* edge, const string& command) {
   finished_.push(edge);
   return true;
 }
@@ -82,6 +82,8 @@ BuildStatus::BuildStatus(const BuildConfig& config)
       start_time_millis_(GetTimeMillis()),
       started_edges_(0), finished_edges_(0), total_edges_(0),
       progress_status_format_(NULL),
+      pending_edge_(NULL), pending_status_(kEdgeStarted),
+      last_redraw_millis_(start_time_millis_ - kRedrawIntervalMillis),
       overall_rate_(), current_rate_(config.parallelism) {
 
   // Don't do anything fancy in verbose mode.
@@ -105,8 +107,10 @@ void BuildStatus::BuildEdgeStarted(Edge* edge) {
   if (edge->use_console() || printer_.is_smart_terminal())
     PrintStatus(edge, kEdgeStarted);
 
-  if (edge->use_console())
+  if (edge->use_console()) {
+    FlushStatus();
     printer_.SetConsoleLocked(true);
+  }
 }
 
 void BuildStatus::BuildEdgeFinished(Edge* edge,
@@ -144,6 +148,10 @@ void BuildStatus::BuildEdgeFinished(Edge* edge,
       PrintStatus(oldest, kEdgeRunning);
   }
 
+  // The status line goes above the output.
+  if (!success || !output.empty())
+    FlushStatus();
+
   // Print the command that is spewing before printing its output.
   if (!success) {
     string outputs;
@@ -193,6 +201,7 @@ void BuildStatus::BuildStarted() {
 }
 
 void BuildStatus::BuildFinished() {
+  FlushStatus();
   printer_.SetConsoleLocked(false);
   printer_.PrintOnNewLine("");
 }
@@ -289,6 +298,34 @@ void BuildStatus::PrintStatus(Edge* edge, EdgeStatus status) {
   if (config_.verbosity == BuildConfig::QUIET)
     return;
 
+  pending_edge_ = edge;
+  pending_status_ = status;
+  // Each line stays visible on dumb terminals, so print them all.
+  if (!printer_.is_smart_terminal() || MillisUntilRedraw() == 0)
+    FlushStatus();
+}
+
+int BuildStatus::MillisUntilRedraw() const {
+  if (!pending_edge_)
+    return -1;
+  int64_t since = GetTimeMillis() - last_redraw_millis_;
+  return since >= kRedrawIntervalMillis
+      ? 0 : (int)(kRedrawIntervalMillis - since);
+}
+
+void BuildStatus::RedrawIfDue() {
+  if (MillisUntilRedraw() == 0)
+    FlushStatus();
+}
+
+void BuildStatus::FlushStatus() {
+  if (!pending_edge_)
+    return;
+  Edge* edge = pending_edge_;
+  EdgeStatus status = pending_status_;
+  pending_edge_ = NULL;
+  last_redraw_millis_ = GetTimeMillis();
+
   bool force_full_command = config_.verbosity == BuildConfig::VERBOSE;
 
   string to_print = edge->GetBinding("description");
@@ -308,13 +345,40 @@ void Plan::Reset() {
   wanted_edges_ = 0;
   ready_.clear();
   want_.clear();
+  want_edges_.clear();
+  pending_inputs_.clear();
+  clean_inputs_.clear();
 }
 
 bool Plan::AddTarget(Node* node, string* err) {
-  return AddSubTarget(node, NULL, err);
+  if (!AddTargets(vector<Node*>(1, node), err))
+    return false;
+  Edge* edge = node->in_edge();
+  return edge && !edge->outputs_ready();
+}
+
+bool Plan::AddTargets(const vector<Node*>& targets, string* err) {
+  METRIC_RECORD("plan");
+  // Walk the graph depth-first, in the same order as recursing into each
+  // target in turn would, but with an explicit stack of (node, dependent)
+  // pairs so that deep graphs can't overflow the native stack.
+  vector<pair<Node*, Node*> > stack;
+  for (vector<Node*>::const_reverse_iterator i = targets.rbegin();
+       i != targets.rend(); ++i) {
+    stack.push_back(make_pair(*i, (Node*)NULL));
+  }
+  while (!stack.empty()) {
+    Node* node = stack.back().first;
+    Node* dependent = stack.back().second;
+    stack.pop_back();
+    if (!AddSubTarget(node, dependent, &stack, err))
+      return false;
+  }
+  return true;
 }
 
-bool Plan::AddSubTarget(Node* node, Node* dependent, string* err) {
+bool Plan::AddSubTarget(Node* node, Node* dependent,
+                        vector<pair<Node*, Node*> >* stack, string* err) {
   Edge* edge = node->in_edge();
   if (!edge) {  // Leaf node.
     if (node->dirty()) {
@@ -323,37 +387,58 @@ bool Plan::AddSubTarget(Node* node, Node* dependent, string* err) {
         referenced = ", needed by '" + dependent->path() + "',";
       *err = "'" + node->path() + "'" + referenced + " missing "
              "and no known rule to make it";
+      return false;
     }
-    return false;
+    return true;
   }
 
   if (edge->outputs_ready())
-    return false;  // Don't need to do anything.
+    return true;  // Don't need to do anything.
 
   // If an entry in want_ does not already exist for edge, create an entry which
   // maps to kWantNothing, indicating that we do not want to build this entry itself.
-  pair<map<Edge*, Want>::iterator, bool> want_ins =
-    want_.insert(make_pair(edge, kWantNothing));
-  Want& want = want_ins.first->second;
+  if (edge->id_ >= want_.size()) {
+    want_.resize(edge->id_ + 1, kWantNotInPlan);
+    want_edges_.resize(edge->id_ + 1, NULL);
+    pending_inputs_.resize(edge->id_ + 1, 0);
+    clean_inputs_.resize(edge->id_ + 1, 0);
+  }
+  bool newly_added = want_[edge->id_] == kWantNotInPlan;
+  if (newly_added) {
+    want_[edge->id_] = kWantNothing;
+    want_edges_[edge->id_] = edge;
+
+    // Count the inputs we have to wait for.  NodeFinished() counts them
+    // down as their in-edges complete.
+    int pending = 0;
+    for (vector<Node*>::iterator i = edge->inputs_.begin();
+         i != edge->inputs_.end(); ++i) {
+      if ((*i)->in_edge() && !(*i)->in_edge()->outputs_ready())
+        ++pending;
+    }
+    pending_inputs_[edge->id_] = pending;
+    clean_inputs_[edge->id_] = 0;
+  }
+  Want& want = want_[edge->id_];
 
   // If we do need to build edge and we haven't already marked it as wanted,
   // mark it now.
   if (node->dirty() && want == kWantNothing) {
     want = kWantToStart;
     ++wanted_edges_;
-    if (edge->AllInputsReady())
-      ScheduleWork(want_ins.first);
+    if (pending_inputs_[edge->id_] == 0)
+      ScheduleWork(edge);
     if (!edge->is_phony())
       ++command_edges_;
   }
 
-  if (!want_ins.second)
+  if (!newly_added)
     return true;  // We've already processed the inputs.
 
-  for (vector<Node*>::iterator i = edge->inputs_.begin();
-       i != edge->inputs_.end(); ++i) {
-    if (!AddSubTarget(*i, node, err) && !err->empty())
-      return false;
+  // Visit the inputs next, first input first.
+  for (vector<Node*>::reverse_iterator i = edge->inputs_.rbegin();
+       i != edge->inputs_.rend(); ++i) {
+    stack->push_back(make_pair(*i, node));
   }
 
   return true;
@@ -368,18 +453,18 @@ Edge* Plan::FindWork() {
   return edge;
 }
 
-void Plan::ScheduleWork(map<Edge*, Want>::iterator want_e) {
-  if (want_e->second == kWantToFinish) {
+void Plan::ScheduleWork(Edge* edge) {
+  Want& want = want_[edge->id_];
+  if (want == kWantToFinish) {
     // This edge has already been scheduled.  We can get here again if an edge
     // and one of its dependencies share an order-only input, or if a node
     // duplicates an out edge (see https://github.com/ninja-build/ninja/pull/519).
     // Avoid scheduling the work again.
     return;
   }
-  assert(want_e->second == kWantToStart);
-  want_e->second = kWantToFinish;
+  assert(want == kWantToStart);
+  want = kWantToFinish;
 
-  Edge* edge = want_e->first;
   Pool* pool = edge->pool();
   if (pool->ShouldDelayEdge()) {
     pool->DelayEdge(edge);
@@ -391,9 +476,9 @@ void Plan::ScheduleWork(map<Edge*, Want>::iterator want_e) {
 }
 
 void Plan::EdgeFinished(Edge* edge, EdgeResult result) {
-  map<Edge*, Want>::iterator e = want_.find(edge);
-  assert(e != want_.end());
-  bool directly_wanted = e->second != kWantNothing;
+  Want want = GetWant(edge);
+  assert(want != kWantNotInPlan);
+  bool directly_wanted = want != kWantNothing;
 
   // See if this job frees up any delayed jobs.
   if (directly_wanted)
@@ -406,7 +491,8 @@ void Plan::EdgeFinished(Edge* edge, EdgeResult result) {
 
   if (directly_wanted)
     --wanted_edges_;
-  want_.erase(e);
+  want_[edge->id_] = kWantNotInPlan;
+  want_edges_[edge->id_] = NULL;
   edge->outputs_ready_ = true;
 
   // Check off any nodes we were waiting for with this edge.
@@ -420,14 +506,17 @@ void Plan::NodeFinished(Node* node) {
   // See if we we want any edges from this node.
   for (vector<Edge*>::const_iterator oe = node->out_edges().begin();
        oe != node->out_edges().end(); ++oe) {
-    map<Edge*, Want>::iterator want_e = want_.find(*oe);
-    if (want_e == want_.end())
+    Want want = GetWant(*oe);
+    if (want == kWantNotInPlan)
       continue;
 
-    // See if the edge is now ready.
-    if ((*oe)->AllInputsReady()) {
-      if (want_e->second != kWantNothing) {
-        ScheduleWork(want_e);
+    // Each entry in out_edges() corresponds to one input of the edge, so
+    // count it off; the edge is ready once no inputs are pending.
+    int& pending = pending_inputs_[(*oe)->id_];
+    assert(pending > 0);
+    if (--pending == 0) {
+      if (want != kWantNothing) {
+        ScheduleWork(*oe);
       } else {
         // We do not need to build this edge, but we might need to build one of
         // its dependents.
@@ -438,30 +527,40 @@ void Plan::NodeFinished(Node* node) {
 }
 
 bool Plan::CleanNode(DependencyScan* scan, Node* node, string* err) {
+  // Walk with an explicit stack, so that long chains of restat edges can't
+  // overflow the native stack.  Nodes are marked clean when they are pushed,
+  // so edges looked at before their turn comes already see them as clean.
   node->set_dirty(false);
+  vector<Node*> stack(1, node);
+  while (!stack.empty()) {
+    node = stack.back();
+    stack.pop_back();
+
+    for (vector<Edge*>::const_iterator oe = node->out_edges().begin();
+         oe != node->out_edges().end(); ++oe) {
+      // Don't process edges that we don't actually want.
+      Want want = GetWant(*oe);
+      if (want == kWantNotInPlan || want == kWantNothing)
+        continue;
 
-  for (vector<Edge*>::const_iterator oe = node->out_edges().begin();
-       oe != node->out_edges().end(); ++oe) {
-    // Don't process edges that we don't actually want.
-    map<Edge*, Want>::iterator want_e = want_.find(*oe);
-    if (want_e == want_.end() || want_e->second == kWantNothing)
-      continue;
+      // Don't attempt to clean an edge if it failed to load deps.
+      if ((*oe)->deps_missing_)
+        continue;
 
-    // Don't attempt to clean an edge if it failed to load deps.
-    if ((*oe)->deps_missing_)
-      continue;
+      // If all non-order-only inputs for this edge are now clean,
+      // we might have changed the dirty state of the outputs.  Nodes don't
+      // become dirty again during a build, so carry on from the first input
+      // that was still dirty the last time; this keeps edges with many
+      // inputs cleaned one by one from being rescanned each time.
+      vector<Node*>::iterator
+          begin = (*oe)->inputs_.begin(),
+          end = (*oe)->inputs_.end() - (*oe)->order_only_deps_;
+      size_t& clean = clean_inputs_[(*oe)->id_];
+      while (begin + clean != end && !begin[clean]->dirty())
+        ++clean;
+      if (begin + clean != end)
+        continue;
 
-    // If all non-order-only inputs for this edge are now clean,
-    // we might have changed the dirty state of the outputs.
-    vector<Node*>::iterator
-        begin = (*oe)->inputs_.begin(),
-        end = (*oe)->inputs_.end() - (*oe)->order_only_deps_;
-#if __cplusplus < 201703L
-#define MEM_FN mem_fun
-#else
-#define MEM_FN mem_fn  // mem_fun was removed in C++17.
-#endif
-    if (find_if(begin, end, MEM_FN(&Node::dirty)) == end) {
       // Recompute most_recent_input.
       Node* most_recent_input = NULL;
       for (vector<Node*>::iterator i = begin; i != end; ++i) {
@@ -480,11 +579,11 @@ bool Plan::CleanNode(DependencyScan* scan, Node* node, string* err) {
       if (!outputs_dirty) {
         for (vector<Node*>::iterator o = (*oe)->outputs_.begin();
              o != (*oe)->outputs_.end(); ++o) {
-          if (!CleanNode(scan, *o, err))
-            return false;
+          (*o)->set_dirty(false);
+          stack.push_back(*o);
         }
 
-        want_e->second = kWantNothing;
+        want_[(*oe)->id_] = kWantNothing;
         --wanted_edges_;
         if (!(*oe)->is_phony())
           --command_edges_;
@@ -495,25 +594,34 @@ bool Plan::CleanNode(DependencyScan* scan, Node* node, string* err) {
 }
 
 void Plan::Dump() {
-  printf("pending: %d\n", (int)want_.size());
-  for (map<Edge*, Want>::iterator e = want_.begin(); e != want_.end(); ++e) {
-    if (e->second != kWantNothing)
+  int pending = 0;
+  for (vector<Want>::iterator w = want_.begin(); w != want_.end(); ++w) {
+    if (*w != kWantNotInPlan)
+      ++pending;
+  }
+  printf("pending: %d\n", pending);
+  for (size_t i = 0; i < want_.size(); ++i) {
+    if (want_[i] == kWantNotInPlan)
+      continue;
+    if (want_[i] != kWantNothing)
       printf("want ");
-    e->first->Dump();
+    want_edges_[i]->Dump();
   }
   printf("ready: %d\n", (int)ready_.size());
 }
 
 struct RealCommandRunner : public CommandRunner {
-  explicit RealCommandRunner(const BuildConfig& config) : config_(config) {}
+  RealCommandRunner(const BuildConfig& config, BuildStatus* status)
+      : config_(config), status_(status) {}
   virtual ~RealCommandRunner() {}
   virtual bool CanRunMore();
-  virtual bool StartCommand(Edge* edge);
+  virtual bool StartCommand(Edge* edge, const string& command);
   virtual bool WaitForCommand(Result* result);
   virtual vector<Edge*> GetActiveEdges();
   virtual void Abort();
 
   const BuildConfig& config_;
+  BuildStatus* status_;
   SubprocessSet subprocs_;
   map<Subprocess*, Edge*> subproc_to_edge_;
 };
@@ -538,8 +646,7 @@ bool RealCommandRunner::CanRunMore() {
         || GetLoadAverage() < config_.max_load_average);
 }
 
-bool RealCommandRunner::StartCommand(Edge* edge) {
-  string command = edge->EvaluateCommand();
+bool RealCommandRunner::StartCommand(Edge* edge, const string& command) {
   Subprocess* subproc = subprocs_.Add(command, edge->use_console());
   if (!subproc)
     return false;
@@ -551,9 +658,11 @@ bool RealCommandRunner::StartCommand(Edge* edge) {
 bool RealCommandRunner::WaitForCommand(Result* result) {
   Subprocess* subproc;
   while ((subproc = subprocs_.NextFinished()) == NULL) {
-    bool interrupted = subprocs_.DoWork();
+    // Wake up in time to draw a deferred status line.
+    bool interrupted = subprocs_.DoWork(status_->MillisUntilRedraw());
     if (interrupted)
       return false;
+    status_->RedrawIfDue();
   }
 
   result->status = subproc->Finish();
@@ -635,6 +744,18 @@ bool Builder::AddTarget(Node* node, string* err) {
   return true;
 }
 
+bool Builder::AddTargets(const vector<Node*>& targets, string* err) {
+  // Scan and plan each target before moving on to the next, so that the
+  // first target with a problem is the one reported.  Edges that are
+  // already in the plan aren't walked again.
+  for (vector<Node*>::const_iterator i = targets.begin();
+       i != targets.end(); ++i) {
+    if (!AddTarget(*i, err) && !err->empty())
+      return false;
+  }
+  return true;
+}
+
 bool Builder::AlreadyUpToDate() const {
   return !plan_.more_to_do();
 }
@@ -645,13 +766,14 @@ bool Builder::Build(string* err) {
   status_->PlanHasTotalEdges(plan_.command_edge_count());
   int pending_commands = 0;
   int failures_allowed = config_.failures_allowed;
+  bool recompacted_logs = false;
 
   // Set up the command runner if we haven't done so already.
   if (!command_runner_.get()) {
     if (config_.dry_run)
       command_runner_.reset(new DryRunCommandRunner);
     else
-      command_runner_.reset(new RealCommandRunner(config_));
+      command_runner_.reset(new RealCommandRunner(config_, status_));
   }
 
   // We are about to start the build process.
@@ -685,6 +807,25 @@ bool Builder::Build(string* err) {
 
     // See if we can reap any finished commands.
     if (pending_commands) {
+      // Recompact the logs while the first commands run, before any of
+      // them is recorded.
+      if (!recompacted_logs) {
+        recompacted_logs = true;
+        if (!RecompactLogs(err)) {
+          Cleanup();
+          status_->BuildFinished();
+          return false;
+        }
+      }
+
+      // Commands that finished since we last got here have been recorded
+      // and their dependents started; write the records out while waiting.
+      if (!FlushLogs(err)) {
+        Cleanup();
+        status_->BuildFinished();
+        return false;
+      }
+
       CommandRunner::Result result;
       if (!command_runner_->WaitForCommand(&result) ||
           result.status == ExitInterrupted) {
@@ -726,7 +867,7 @@ bool Builder::Build(string* err) {
   }
 
   status_->BuildFinished();
-  return true;
+  return FlushLogs(err);
 }
 
 bool Builder::StartEdge(Edge* edge, string* err) {
@@ -736,26 +877,49 @@ bool Builder::StartEdge(Edge* edge, string* err) {
 
   status_->BuildEdgeStarted(edge);
 
-  // Create directories necessary for outputs.
-  // XXX: this will block; do we care?
+  // Create directories necessary for outputs.  A directory made earlier
+  // in this build only needs one stat to check that no command removed
+  // it since, instead of one for each of its ancestors.
   for (vector<Node*>::iterator o = edge->outputs_.begin();
        o != edge->outputs_.end(); ++o) {
+    string dir = DirName((*o)->path());
+    if (dir.empty())
+      continue;
+    if (made_dirs_.count(dir)) {
+      string stat_err;
+      if (disk_interface_->Stat(dir, &stat_err) > 0)
+        continue;
+    }
     if (!disk_interface_->MakeDirs((*o)->path()))
       return false;
+    made_dirs_.insert(dir);
+  }
+
+  // Expanding the command and the response file contents can be costly
+  // for edges with many inputs, so do it once: the build log records the
+  // hash of both when the edge finishes.  A dry run doesn't run the
+  // command, so it only expands what it writes out.
+  string command;
+  string rspfile_content;
+  string rspfile = edge->GetUnescapedRspfile();
+  if (!config_.dry_run || !rspfile.empty())
+    rspfile_content = edge->GetBinding("rspfile_content");
+  if (!config_.dry_run) {
+    command = edge->EvaluateCommand();
+    if (scan_.build_log())
+      edge->PrimeCommandHash(command, rspfile_content);
   }
 
   // Create response file, if needed
   // XXX: this may also block; do we care?
-  string rspfile = edge->GetUnescapedRspfile();
   if (!rspfile.empty()) {
-    string content = edge->GetBinding("rspfile_content");
-    if (!disk_interface_->WriteFile(rspfile, content))
+    if (!disk_interface_->WriteFile(rspfile, rspfile_content))
       return false;
   }
 
-  // start command computing and run it
-  if (!command_runner_->StartCommand(edge)) {
-    err->assign("command '" + edge->EvaluateCommand() + "' failed.");
+  // run the command
+  if (!command_runner_->StartCommand(edge, command)) {
+    err->assign("command '" + command + "' failed.");
     return false;
   }
 
@@ -801,8 +965,9 @@ bool Builder::FinishCommand(CommandRunner::Result* result, string* err) {
   TimeStamp output_mtime = 0;
   bool restat = edge->GetBindingBool("restat");
   if (!config_.dry_run) {
-    bool node_cleaned = false;
-
+    // Stat all outputs before propagating any clean state, so that the
+    // plan is only walked once the whole edge is known.
+    vector<Node*> unchanged;
     for (vector<Node*>::iterator o = edge->outputs_.begin();
          o != edge->outputs_.end(); ++o) {
       TimeStamp new_mtime = disk_interface_->Stat((*o)->path(), err);
@@ -810,20 +975,25 @@ bool Builder::FinishCommand(CommandRunner::Result* result, string* err) {
         return false;
       if (new_mtime > output_mtime)
         output_mtime = new_mtime;
-      if ((*o)->mtime() == new_mtime && restat) {
-        // The rule command did not change the output.  Propagate the clean
-        // state through the build graph.
-        // Note that this also applies to nonexistent outputs (mtime == 0).
-        if (!plan_.CleanNode(&scan_, *o, err))
-          return false;
-        node_cleaned = true;
-      }
+      if ((*o)->mtime() == new_mtime && restat)
+        unchanged.push_back(*o);
+    }
+
+    // The rule command did not change these outputs.  Propagate the clean
+    // state through the build graph.
+    // Note that this also applies to nonexistent outputs (mtime == 0).
+    for (vector<Node*>::iterator o = unchanged.begin(); o != unchanged.end();
+         ++o) {
+      if (!plan_.CleanNode(&scan_, *o, err))
+        return false;
     }
 
-    if (node_cleaned) {
+    if (!unchanged.empty()) {
       TimeStamp restat_mtime = 0;
       // If any output was cleaned, find the most recent mtime of any
-      // (existing) non-order-only input or the depfile.
+      // (existing) non-order-only input or the depfile.  Inputs built
+      // earlier in this run still carry their pre-build mtime on the node,
+      // so they have to be stat'ed again.
       for (vector<Node*>::iterator i = edge->inputs_.begin();
            i != edge->inputs_.end() - edge->order_only_deps_; ++i) {
         TimeStamp input_mtime = disk_interface_->Stat((*i)->path(), err);
@@ -879,6 +1049,32 @@ bool Builder::FinishCommand(CommandRunner::Result* result, string* err) {
   return true;
 }
 
+bool Builder::RecompactLogs(string* err) {
+  BuildLog* build_log = scan_.build_log();
+  if (build_log && !build_log->RecompactIfNeeded(err)) {
+    *err = "recompacting build log: " + *err;
+    return false;
+  }
+  DepsLog* deps_log = scan_.deps_log();
+  if (deps_log && !deps_log->RecompactIfNeeded(err)) {
+    *err = "recompacting deps log: " + *err;
+    return false;
+  }
+  return true;
+}
+
+bool Builder::FlushLogs(string* err) {
+  if (scan_.build_log() && !scan_.build_log()->Flush()) {
+    *err = string("Error writing to build log: ") + strerror(errno);
+    return false;
+  }
+  if (scan_.deps_log() && !scan_.deps_log()->Flush()) {
+    *err = string("Error writing to deps log: ") + strerror(errno);
+    return false;
+  }
+  return true;
+}
+
 bool Builder::ExtractDeps(CommandRunner::Result* result,
                           const string& deps_type,
                           const string& deps_prefix,
@@ -46,6 +46,12 @@ struct Plan {
   /// fill in |err| with an error message if there's a problem.
   bool AddTarget(Node* node, string* err);
 
+  /// Add several targets to our plan in one pass over the graph, visiting
+  /// each edge once no matter how many targets share it.  Targets that
+  /// are up to date are skipped.  Returns false and fills in |err| if
+  /// there's a problem.
+  bool AddTargets(const vector<Node*>& targets, string* err);
+
   // Pop a ready edge off the queue of edges to build.
   // Returns NULL if there's no work to do.
   Edge* FindWork();
@@ -75,12 +81,18 @@ struct Plan {
   void Reset();
 
 private:
-  bool AddSubTarget(Node* node, Node* dependent, string* err);
+  /// Add |node| to the plan and push the inputs of its in-edge onto
+  /// |stack| if the edge is new to the plan.
+  bool AddSubTarget(Node* node, Node* dependent,
+                    vector<pair<Node*, Node*> >* stack, string* err);
   void NodeFinished(Node* node);
 
   /// Enumerate possible steps we want for an edge.
   enum Want
   {
+    /// The edge is not part of the plan: we want neither it nor any of its
+    /// dependents.
+    kWantNotInPlan,
     /// We do not want to build the edge, but we might want to build one of
     /// its dependents.
     kWantNothing,
@@ -94,13 +106,31 @@ private:
   /// Submits a ready edge as a candidate for execution.
   /// The edge may be delayed from running, for example if it's a member of a
   /// currently-full pool.
-  void ScheduleWork(map<Edge*, Want>::iterator want_e);
+  void ScheduleWork(Edge* edge);
+
+  /// Return what we want for |edge|, kWantNotInPlan if it is not in the plan.
+  Want GetWant(const Edge* edge) const {
+    return edge->id_ < want_.size() ? want_[edge->id_] : kWantNotInPlan;
+  }
+
+  /// Keep track of which edges we want to build in this plan, indexed by
+  /// Edge::id_.  Edges beyond the end of the vector, like those marked
+  /// kWantNotInPlan, are not part of the plan; otherwise the enumeration
+  /// indicates what we want for the edge.
+  vector<Want> want_;
+
+  /// The edges in the plan, parallel to |want_|.  Only used by Dump().
+  vector<Edge*> want_edges_;
 
-  /// Keep track of which edges we want to build in this plan.  If this map does
-  /// not contain an entry for an edge, we do not want to build the entry or its
-  /// dependents.  If it does contain an entry, the enumeration indicates what
-  /// we want for the edge.
-  map<Edge*, Want> want_;
+  /// For each edge in the plan, parallel to |want_|, the number of inputs
+  /// whose in-edge has not finished yet.  The edge is ready once it drops
+  /// to zero; this replaces rescanning all inputs with
+  /// Edge::AllInputsReady() every time one of them finishes.
+  vector<int> pending_inputs_;
+
+  /// For each edge in the plan, parallel to |want_|, how many of its
+  /// leading inputs CleanNode() has found to be clean.
+  vector<size_t> clean_inputs_;
 
   set<Edge*> ready_;
 
@@ -117,7 +147,9 @@ private:
 struct CommandRunner {
   virtual ~CommandRunner() {}
   virtual bool CanRunMore() = 0;
-  virtual bool StartCommand(Edge* edge) = 0;
+  /// Start running \a command, which is \a edge's evaluated command, or
+  /// empty in a dry run.
+  virtual bool StartCommand(Edge* edge, const string& command) = 0;
 
   /// The result of waiting for a command.
   struct Result {
@@ -169,6 +201,11 @@ struct Builder {
   /// @return false on error.
   bool AddTarget(Node* target, string* err);
 
+  /// Add several targets to the build, as if by AddTarget() in turn.
+  /// Targets that are up to date are skipped.
+  /// @return false on error.
+  bool AddTargets(const vector<Node*>& targets, string* err);
+
   /// Returns true if the build targets are already up to date.
   bool AlreadyUpToDate() const;
 
@@ -202,9 +239,19 @@ struct Builder {
                     const string& deps_prefix, vector<Node*>* deps_nodes,
                     string* err);
 
+   /// Rewrite the build and deps logs if they have grown too large.
+   bool RecompactLogs(string* err);
+   /// Write out the records buffered by the build and deps logs.
+   bool FlushLogs(string* err);
+
   DiskInterface* disk_interface_;
   DependencyScan scan_;
 
+  /// Directories of outputs that the build has made sure exist.  Outputs
+  /// mostly share directories, so this saves stat()ing their parents
+  /// again for each edge.
+  set<string> made_dirs_;
+
   // Unimplemented copy ctor and operator= ensure we don't copy the auto_ptr.
   Builder(const Builder &other);        // DO NOT IMPLEMENT
   void operator=(const Builder &other); // DO NOT IMPLEMENT
@@ -234,9 +281,22 @@ struct BuildStatus {
   string FormatProgressStatus(const char* progress_status_format,
                               EdgeStatus status) const;
 
+  /// @return how many milliseconds until a deferred status line is due to
+  /// be drawn, or -1 if there is none.
+  int MillisUntilRedraw() const;
+
+  /// Draw the deferred status line if it is due.
+  void RedrawIfDue();
+
+  /// Used for tests.
+  LinePrinter* printer() { return &printer_; }
+
  private:
   void PrintStatus(Edge* edge, EdgeStatus status);
 
+  /// Draw the deferred status line, if any, now.
+  void FlushStatus();
+
   const BuildConfig& config_;
 
   /// Time the build started.
@@ -254,6 +314,17 @@ struct BuildStatus {
   /// The custom progress status format to use.
   const char* progress_status_format_;
 
+  /// On smart terminals, where the status line is overprinted, draw it at
+  /// most this often; in between, only the latest status is kept.
+  static const int kRedrawIntervalMillis = 50;
+
+  /// The status line waiting to be drawn, or NULL.
+  Edge* pending_edge_;
+  EdgeStatus pending_status_;
+
+  /// When the status line was last drawn.
+  int64_t last_redraw_millis_;
+
   template<size_t S>
   void SnprintfRate(double rate, char(&buf)[S], const char* format) const {
     if (rate == -1)
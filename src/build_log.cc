@@ -42,6 +42,9 @@
 // older runs.
 // Once the number of redundant entries exceeds a threshold, we write
 // out a new file and replace the existing one with it.
+// Entries are written out in batches, so a crash can leave a partial line
+// at the end of the log; loading skips it, and opening the log for writing
+// truncates it.
 
 namespace {
 
@@ -109,7 +112,9 @@ BuildLog::LogEntry::LogEntry(const string& output, uint64_t command_hash,
 {}
 
 BuildLog::BuildLog()
-  : log_file_(NULL), needs_recompaction_(false) {}
+  : log_file_(NULL), user_(NULL), log_file_size_(0),
+    partial_line_offset_(-1), needs_recompaction_(false),
+    needs_upgrade_(false) {}
 
 BuildLog::~BuildLog() {
   Close();
@@ -117,37 +122,68 @@ BuildLog::~BuildLog() {
 
 bool BuildLog::OpenForWrite(const string& path, const BuildLogUser& user,
                             string* err) {
-  if (needs_recompaction_) {
+  if (needs_upgrade_) {
     if (!Recompact(path, user, err))
       return false;
   }
+  if (partial_line_offset_ >= 0) {
+    // Writing a batch of entries was interrupted; drop the partial line so
+    // that new entries start on a line of their own.
+    if (!Truncate(path, partial_line_offset_, err))
+      return false;
+    partial_line_offset_ = -1;
+  }
 
   log_file_ = fopen(path.c_str(), "ab");
   if (!log_file_) {
     *err = strerror(errno);
     return false;
   }
-  setvbuf(log_file_, NULL, _IOLBF, BUFSIZ);
+  // Records are collected in |pending_| and written whole by Flush(), so
+  // the stream itself must not split them.
+  setvbuf(log_file_, NULL, _IONBF, 0);
   SetCloseOnExec(fileno(log_file_));
 
   // Opening a file in append mode doesn't set the file pointer to the file's
   // end on Windows. Do that explicitly.
   fseek(log_file_, 0, SEEK_END);
 
-  if (ftell(log_file_) == 0) {
+  log_file_size_ = ftell(log_file_);
+  if (log_file_size_ == 0) {
     if (fprintf(log_file_, kFileSignature, kCurrentVersion) < 0) {
       *err = strerror(errno);
       return false;
     }
   }
 
+  log_file_path_ = path;
+  user_ = &user;
   return true;
 }
 
+bool BuildLog::RecompactIfNeeded(string* err) {
+  if (!needs_recompaction_ || !log_file_)
+    return true;
+  needs_recompaction_ = false;
+
+  // Entries appended since the log was opened aren't in |entries_| if
+  // another ninja wrote them, so leave the rewrite to a later run.  Nothing
+  // locks the file, so this doesn't protect entries appended after this
+  // check.
+  if (fseek(log_file_, 0, SEEK_END) != 0 ||
+      ftell(log_file_) != log_file_size_) {
+    return true;
+  }
+
+  string path = log_file_path_;
+  if (!Recompact(path, *user_, err))
+    return false;
+  return OpenForWrite(path, *user_, err);
+}
+
 bool BuildLog::RecordCommand(Edge* edge, int start_time, int end_time,
                              TimeStamp mtime) {
-  string command = edge->EvaluateCommand(true);
-  uint64_t command_hash = LogEntry::HashCommand(command);
+  uint64_t command_hash = edge->GetCommandHash();
   for (vector<Node*>::iterator out = edge->outputs_.begin();
        out != edge->outputs_.end(); ++out) {
     const string& path = (*out)->path();
@@ -164,18 +200,24 @@ bool BuildLog::RecordCommand(Edge* edge, int start_time, int end_time,
     log_entry->end_time = end_time;
     log_entry->mtime = mtime;
 
-    if (log_file_) {
-      if (!WriteEntry(log_file_, *log_entry))
-        return false;
-      if (fflush(log_file_) != 0) {
-          return false;
-      }
-    }
+    if (log_file_)
+      FormatEntry(*log_entry, &pending_);
   }
   return true;
 }
 
+bool BuildLog::Flush() {
+  if (!log_file_ || pending_.empty())
+    return true;
+  // One write per batch; with the file opened for append, records from
+  // other processes can only end up between batches, not inside them.
+  bool ok = fwrite(pending_.data(), pending_.size(), 1, log_file_) == 1;
+  pending_.clear();
+  return ok;
+}
+
 void BuildLog::Close() {
+  Flush();
   if (log_file_)
     fclose(log_file_);
   log_file_ = NULL;
@@ -222,6 +264,11 @@ struct LineReader {
     return true;
   }
 
+  // Returns the file offset of the line last returned by ReadLine().
+  long LineOffset() {
+    return ftell(file_) - (buf_end_ - line_start_);
+  }
+
  private:
   FILE* file_;
   char buf_[256 << 10];
@@ -234,7 +281,7 @@ struct LineReader {
 
 bool BuildLog::Load(const string& path, string* err) {
   METRIC_RECORD(".ninja_log load");
-  FILE* file = fopen(path.c_str(), "r");
+  FILE* file = fopen(path.c_str(), "rb");
   if (!file) {
     if (errno == ENOENT)
       return true;
@@ -327,6 +374,9 @@ bool BuildLog::Load(const string& path, string* err) {
                                                               end - start));
     }
   }
+  // The last line is empty unless the file ends in a partial line.
+  if (line_start && !line_end && reader.LineOffset() < ftell(file))
+    partial_line_offset_ = reader.LineOffset();
   fclose(file);
 
   if (!line_start) {
@@ -339,7 +389,7 @@ bool BuildLog::Load(const string& path, string* err) {
   int kMinCompactionEntryCount = 100;
   int kCompactionRatio = 3;
   if (log_version < kCurrentVersion) {
-    needs_recompaction_ = true;
+    needs_upgrade_ = true;
   } else if (total_entry_count > kMinCompactionEntryCount &&
              total_entry_count > unique_entry_count * kCompactionRatio) {
     needs_recompaction_ = true;
@@ -355,10 +405,20 @@ BuildLog::LogEntry* BuildLog::LookupByOutput(const string& path) {
   return NULL;
 }
 
+void BuildLog::FormatEntry(const LogEntry& entry, string* out) {
+  char buf[80];
+  snprintf(buf, sizeof(buf), "%d\t%d\t%" PRId64 "\t",
+           entry.start_time, entry.end_time, entry.mtime);
+  *out += buf;
+  *out += entry.output;
+  snprintf(buf, sizeof(buf), "\t%" PRIx64 "\n", entry.command_hash);
+  *out += buf;
+}
+
 bool BuildLog::WriteEntry(FILE* f, const LogEntry& entry) {
-  return fprintf(f, "%d\t%d\t%" PRId64 "\t%s\t%" PRIx64 "\n",
-          entry.start_time, entry.end_time, entry.mtime,
-          entry.output.c_str(), entry.command_hash) > 0;
+  string line;
+  FormatEntry(entry, &line);
+  return fwrite(line.data(), line.size(), 1, f) == 1;
 }
 
 bool BuildLog::Recompact(const string& path, const BuildLogUser& user,
@@ -366,6 +426,9 @@ bool BuildLog::Recompact(const string& path, const BuildLogUser& user,
   METRIC_RECORD(".ninja_log recompact");
 
   Close();
+  needs_recompaction_ = false;
+  needs_upgrade_ = false;
+  partial_line_offset_ = -1;
   string temp_path = path + ".recompact";
   FILE* f = fopen(temp_path.c_str(), "wb");
   if (!f) {
@@ -397,11 +460,16 @@ bool BuildLog::Recompact(const string& path, const BuildLogUser& user,
     entries_.erase(dead_outputs[i]);
 
   fclose(f);
+#ifdef _WIN32
+  // rename() doesn't replace existing files on Windows.
   if (unlink(path.c_str()) < 0) {
     *err = strerror(errno);
     return false;
   }
+#endif
 
+  // Atomically replace the old log, so a concurrent reader never sees it
+  // missing.
   if (rename(temp_path.c_str(), path.c_str()) < 0) {
     *err = strerror(errno);
     return false;
@@ -44,8 +44,12 @@ struct BuildLog {
   ~BuildLog();
 
   bool OpenForWrite(const string& path, const BuildLogUser& user, string* err);
+  /// Records are buffered; they are written out by Flush() or Close().
   bool RecordCommand(Edge* edge, int start_time, int end_time,
                      TimeStamp mtime = 0);
+  /// Write out the buffered records with a single write, so that a crash
+  /// or another ninja appending to the log can't split one.
+  bool Flush();
   void Close();
 
   /// Load the on-disk log.
@@ -77,17 +81,41 @@ struct BuildLog {
 
   /// Serialize an entry into a log file.
   bool WriteEntry(FILE* f, const LogEntry& entry);
+  /// Append the serialized form of an entry to |out|.
+  static void FormatEntry(const LogEntry& entry, string* out);
 
   /// Rewrite the known log entries, throwing away old data.
   bool Recompact(const string& path, const BuildLogUser& user, string* err);
 
+  /// Rewrite the log opened by OpenForWrite() if Load() found too many
+  /// redundant entries in it, and continue appending to the new file.
+  /// This is deferred from OpenForWrite() so that it can overlap with the
+  /// first commands of a build.  If anything was appended to the log since
+  /// it was opened, by this or another process, the rewrite is skipped.
+  /// That check is not atomic with the rewrite: entries another ninja
+  /// appends to the same log while it is being rewritten are lost.  Like
+  /// losing a log, that only makes the next build rerun their commands.
+  bool RecompactIfNeeded(string* err);
+
   typedef ExternalStringHashMap<LogEntry*>::Type Entries;
   const Entries& entries() const { return entries_; }
 
  private:
   Entries entries_;
   FILE* log_file_;
+  /// Records not written out by Flush() yet.
+  string pending_;
+  string log_file_path_;
+  const BuildLogUser* user_;
+  /// Size of the log file when it was opened for writing.
+  long log_file_size_;
+  /// Offset of a partial line that Load() found at the end of the log, or
+  /// -1.  OpenForWrite() truncates it.
+  long partial_line_offset_;
   bool needs_recompaction_;
+  /// Whether the log file has an old version and must be rewritten
+  /// before anything is appended to it.
+  bool needs_upgrade_;
 };
 
 #endif // NINJA_BUILD_LOG_H_
@@ -154,6 +154,61 @@ TEST_F(BuildLogTest, Truncate) {
   }
 }
 
+TEST_F(BuildLogTest, BatchedWrites) {
+  AssertParse(&state_,
+"build out: cat mid\n"
+"build mid: cat in\n");
+
+  BuildLog log1;
+  string err;
+  EXPECT_TRUE(log1.OpenForWrite(kTestFilename, *this, &err));
+  ASSERT_EQ("", err);
+  ASSERT_TRUE(log1.Flush());
+  struct stat statbuf;
+  ASSERT_EQ(0, stat(kTestFilename, &statbuf));
+  off_t size = statbuf.st_size;
+
+  // Entries stay buffered until the log is flushed.
+  log1.RecordCommand(state_.edges_[0], 15, 18);
+  ASSERT_EQ(0, stat(kTestFilename, &statbuf));
+  ASSERT_EQ(size, statbuf.st_size);
+  ASSERT_TRUE(log1.Flush());
+  ASSERT_EQ(0, stat(kTestFilename, &statbuf));
+  ASSERT_GT(statbuf.st_size, size);
+  log1.Close();
+
+  // Simulate a flush that was interrupted halfway through a line.
+  FILE* f = fopen(kTestFilename, "ab");
+  fprintf(f, "20\t25\t0\tmi");
+  fclose(f);
+
+  ASSERT_EQ(0, stat(kTestFilename, &statbuf));
+  size = statbuf.st_size;
+
+  // Loading skips the partial line but leaves the file alone.
+  BuildLog log2;
+  EXPECT_TRUE(log2.Load(kTestFilename, &err));
+  ASSERT_EQ("", err);
+  ASSERT_EQ(1u, log2.entries().size());
+  ASSERT_EQ(0, stat(kTestFilename, &statbuf));
+  ASSERT_EQ(size, statbuf.st_size);
+
+  // Opening it for writing drops the partial line.
+  EXPECT_TRUE(log2.OpenForWrite(kTestFilename, *this, &err));
+  ASSERT_EQ("", err);
+  log2.RecordCommand(state_.edges_[1], 20, 25);
+  log2.Close();
+
+  BuildLog log3;
+  EXPECT_TRUE(log3.Load(kTestFilename, &err));
+  ASSERT_EQ("", err);
+  ASSERT_EQ(2u, log3.entries().size());
+  BuildLog::LogEntry* e = log3.LookupByOutput("mid");
+  ASSERT_TRUE(e);
+  ASSERT_EQ(20, e->start_time);
+  ASSERT_EQ(25, e->end_time);
+}
+
 TEST_F(BuildLogTest, ObsoleteOldVersion) {
   FILE* f = fopen(kTestFilename, "wb");
   fprintf(f, "# ninja log v3\n");
@@ -293,6 +348,10 @@ TEST_F(BuildLogRecompactTest, Recompact) {
   ASSERT_TRUE(log2.LookupByOutput("out2"));
   // ...and force a recompaction.
   EXPECT_TRUE(log2.OpenForWrite(kTestFilename, *this, &err));
+  EXPECT_TRUE(log2.RecompactIfNeeded(&err));
+  ASSERT_EQ("", err);
+  // The rewritten log should still be open for appending.
+  log2.RecordCommand(state_.edges_[0], 30, 31);
   log2.Close();
 
   // "out2" is dead, it should've been removed.
@@ -302,6 +361,48 @@ TEST_F(BuildLogRecompactTest, Recompact) {
   ASSERT_EQ(1u, log2.entries().size());
   ASSERT_TRUE(log2.LookupByOutput("out"));
   ASSERT_FALSE(log2.LookupByOutput("out2"));
+  ASSERT_EQ(30, log2.LookupByOutput("out")->start_time);
+}
+
+TEST_F(BuildLogRecompactTest, SkipRecompactAfterAppend) {
+  AssertParse(&state_,
+"build out: cat in\n");
+
+  BuildLog log1;
+  string err;
+  EXPECT_TRUE(log1.OpenForWrite(kTestFilename, *this, &err));
+  ASSERT_EQ("", err);
+  for (int i = 0; i < 200; ++i)
+    log1.RecordCommand(state_.edges_[0], 15, 18 + i);
+  log1.Close();
+
+  struct stat st;
+  ASSERT_EQ(0, stat(kTestFilename, &st));
+  long size = (long)st.st_size;
+
+  BuildLog log2;
+  EXPECT_TRUE(log2.Load(kTestFilename, &err));
+  ASSERT_EQ("", err);
+  // Opening the log doesn't recompact it right away.
+  EXPECT_TRUE(log2.OpenForWrite(kTestFilename, *this, &err));
+  ASSERT_EQ(0, stat(kTestFilename, &st));
+  ASSERT_EQ(size, (long)st.st_size);
+
+  // Another ninja appends to the log, so it must not be rewritten.
+  BuildLog log3;
+  EXPECT_TRUE(log3.OpenForWrite(kTestFilename, *this, &err));
+  log3.RecordCommand(state_.edges_[0], 40, 41);
+  log3.Close();
+
+  EXPECT_TRUE(log2.RecompactIfNeeded(&err));
+  ASSERT_EQ("", err);
+  log2.Close();
+
+  BuildLog log4;
+  EXPECT_TRUE(log4.Load(kTestFilename, &err));
+  ASSERT_EQ("", err);
+  ASSERT_TRUE(log4.LookupByOutput("out"));
+  ASSERT_EQ(40, log4.LookupByOutput("out")->start_time);
 }
 
 }  // anonymous namespace
@@ -15,6 +15,9 @@
 #include "build.h"
 
 #include <assert.h>
+#ifndef _WIN32
+#include <unistd.h>
+#endif
 
 #include "build_log.h"
 #include "deps_log.h"
@@ -147,6 +150,99 @@ TEST_F(PlanTest, DoubleOutputIndirect) {
   ASSERT_FALSE(edge);  // done
 }
 
+// Test that a fan-in edge with a duplicated input and an order-only input
+// only becomes ready once every input has been built.
+TEST_F(PlanTest, FanInWaitsForAllInputs) {
+  ASSERT_NO_FATAL_FAILURE(AssertParse(&state_,
+"build out: cat a1 a2 a1 || oo\n"
+"build a1: cat in\n"
+"build a2: cat in\n"
+"build oo: cat in\n"));
+  GetNode("a1")->MarkDirty();
+  GetNode("a2")->MarkDirty();
+  GetNode("oo")->MarkDirty();
+  GetNode("out")->MarkDirty();
+  string err;
+  EXPECT_TRUE(plan_.AddTarget(GetNode("out"), &err));
+  ASSERT_EQ("", err);
+  ASSERT_TRUE(plan_.more_to_do());
+
+  deque<Edge*> edges;
+  FindWorkSorted(&edges, 3);
+  ASSERT_EQ("a1", edges[0]->outputs_[0]->path());
+  ASSERT_EQ("a2", edges[1]->outputs_[0]->path());
+  ASSERT_EQ("oo", edges[2]->outputs_[0]->path());
+
+  plan_.EdgeFinished(edges[0], Plan::kEdgeSucceeded);
+  plan_.EdgeFinished(edges[1], Plan::kEdgeSucceeded);
+  ASSERT_FALSE(plan_.FindWork());  // Still waiting for oo.
+
+  plan_.EdgeFinished(edges[2], Plan::kEdgeSucceeded);
+  Edge* edge = plan_.FindWork();
+  ASSERT_TRUE(edge);
+  ASSERT_EQ("out", edge->outputs_[0]->path());
+  plan_.EdgeFinished(edge, Plan::kEdgeSucceeded);
+
+  ASSERT_FALSE(plan_.more_to_do());
+}
+
+// Test that adding targets that share most of their dependencies in one
+// batch plans each shared edge once.
+TEST_F(PlanTest, AddTargetsSharedSubgraph) {
+  ASSERT_NO_FATAL_FAILURE(AssertParse(&state_,
+"build t1: cat common a\n"
+"build t2: cat common b\n"
+"build t3: cat common\n"
+"build common: cat in\n"
+"build a: cat in\n"
+"build b: cat in\n"));
+  GetNode("common")->MarkDirty();
+  GetNode("a")->MarkDirty();
+  GetNode("t1")->MarkDirty();
+  GetNode("t2")->MarkDirty();
+  GetNode("t3")->MarkDirty();
+  // "b" is up to date, so "t2" only waits for "common".
+  GetNode("b")->in_edge()->outputs_ready_ = true;
+
+  vector<Node*> targets;
+  targets.push_back(GetNode("t1"));
+  targets.push_back(GetNode("t2"));
+  targets.push_back(GetNode("t3"));
+  targets.push_back(GetNode("t1"));
+  string err;
+  EXPECT_TRUE(plan_.AddTargets(targets, &err));
+  ASSERT_EQ("", err);
+  EXPECT_EQ(5, plan_.command_edge_count());
+
+  deque<Edge*> edges;
+  FindWorkSorted(&edges, 2);
+  ASSERT_EQ("a", edges[0]->outputs_[0]->path());
+  ASSERT_EQ("common", edges[1]->outputs_[0]->path());
+
+  plan_.EdgeFinished(edges[1], Plan::kEdgeSucceeded);
+  edges.clear();
+  FindWorkSorted(&edges, 2);
+  ASSERT_EQ("t2", edges[0]->outputs_[0]->path());
+  ASSERT_EQ("t3", edges[1]->outputs_[0]->path());
+}
+
+// Test that a batch reports the first missing input it runs into.
+TEST_F(PlanTest, AddTargetsMissingInput) {
+  ASSERT_NO_FATAL_FAILURE(AssertParse(&state_,
+"build t1: cat in1\n"
+"build t2: cat in2\n"));
+  GetNode("in2")->MarkDirty();
+  GetNode("t2")->MarkDirty();
+
+  vector<Node*> targets;
+  targets.push_back(GetNode("t1"));
+  targets.push_back(GetNode("t2"));
+  string err;
+  EXPECT_FALSE(plan_.AddTargets(targets, &err));
+  ASSERT_EQ("'in2', needed by 't2', missing and no known rule to make it",
+            err);
+}
+
 // Test that two edges from one output can both execute.
 TEST_F(PlanTest, DoubleDependent) {
   ASSERT_NO_FATAL_FAILURE(AssertParse(&state_,
@@ -445,7 +541,7 @@ struct FakeCommandRunner : public CommandRunner {
 
   // CommandRunner impl
   virtual bool CanRunMore();
-  virtual bool StartCommand(Edge* edge);
+  virtual bool StartCommand(Edge* edge, const string& command);
   virtual bool WaitForCommand(Result* result);
   virtual vector<Edge*> GetActiveEdges();
   virtual void Abort();
@@ -547,8 +643,10 @@ bool FakeCommandRunner::CanRunMore() {
   return last_command_ == NULL;
 }
 
-bool FakeCommandRunner::StartCommand(Edge* edge) {
+bool FakeCommandRunner::StartCommand(Edge* edge, const string& command) {
   assert(!last_command_);
+  // Dry runs don't expand the command.
+  assert(command.empty() || command == edge->EvaluateCommand());
   commands_ran_.push_back(edge->EvaluateCommand());
   if (edge->rule().name() == "cat"  ||
       edge->rule().name() == "cat_rsp" ||
@@ -561,6 +659,17 @@ bool FakeCommandRunner::StartCommand(Edge* edge) {
          out != edge->outputs_.end(); ++out) {
       fs_->Create((*out)->path(), "");
     }
+  } else if (edge->rule().name() == "rm-dir") {
+    // Remove the directory named by $dir, and everything in it.
+    string dir = edge->GetBinding("dir");
+    for (VirtualFileSystem::FileMap::iterator i = fs_->files_.begin();
+         i != fs_->files_.end();) {
+      if (i->first == dir ||
+          i->first.compare(0, dir.size() + 1, dir + "/") == 0)
+        fs_->files_.erase(i++);
+      else
+        ++i;
+    }
   } else if (edge->rule().name() == "true" ||
              edge->rule().name() == "fail" ||
              edge->rule().name() == "interrupt" ||
@@ -632,6 +741,30 @@ TEST_F(BuildTest, NoWork) {
   EXPECT_TRUE(builder_.AlreadyUpToDate());
 }
 
+// Test that several targets report errors in the order that adding them
+// one at a time would.
+TEST_F(BuildTest, AddTargetsErrorOrder) {
+  ASSERT_NO_FATAL_FAILURE(AssertParse(&state_,
+"build missing_in: cat missing\n"
+"build cycle: cat loop\n"
+"build loop: cat cycle\n"));
+
+  vector<Node*> targets;
+  targets.push_back(GetNode("cat1"));
+  targets.push_back(GetNode("missing_in"));
+  targets.push_back(GetNode("cycle"));
+  string err;
+  EXPECT_FALSE(builder_.AddTargets(targets, &err));
+  EXPECT_EQ("'missing', needed by 'missing_in', missing and no known rule to "
+            "make it", err);
+
+  state_.Reset();
+  swap(targets[1], targets[2]);
+  err.clear();
+  EXPECT_FALSE(builder_.AddTargets(targets, &err));
+  EXPECT_EQ("dependency cycle: cycle -> loop -> cycle", err);
+}
+
 TEST_F(BuildTest, OneStep) {
   // Given a dirty target with one ready input,
   // we should rebuild the target.
@@ -816,6 +949,44 @@ TEST_F(BuildTest, MakeDirs) {
   EXPECT_EQ("subdir/dir2", fs_.directories_made_[1]);
 }
 
+TEST_F(BuildTest, MakeDirsOnce) {
+  string err;
+  ASSERT_NO_FATAL_FAILURE(AssertParse(&state_,
+"build subdir/a: cat in1\n"
+"build subdir/b: cat in1\n"));
+  EXPECT_TRUE(builder_.AddTarget("subdir/a", &err));
+  EXPECT_TRUE(builder_.AddTarget("subdir/b", &err));
+  EXPECT_EQ("", err);
+  EXPECT_TRUE(builder_.Build(&err));
+  ASSERT_EQ("", err);
+  // The virtual file system doesn't remember directories, so each time
+  // the build looked for subdir it would have made it.
+  ASSERT_EQ(1u, fs_.directories_made_.size());
+  EXPECT_EQ("subdir", fs_.directories_made_[0]);
+}
+
+TEST_F(BuildTest, MakeDirsAgainAfterRemoval) {
+  string err;
+  ASSERT_NO_FATAL_FAILURE(AssertParse(&state_,
+"rule rm-dir\n"
+"  command = rm -rf $dir\n"
+"build subdir/a: cat in1\n"
+"build clean: rm-dir subdir/a\n"
+"  dir = subdir\n"
+"build subdir/b: cat in1 || clean\n"));
+  EXPECT_TRUE(builder_.AddTarget("subdir/b", &err));
+  EXPECT_TRUE(builder_.AddTarget("subdir/a", &err));
+  EXPECT_EQ("", err);
+  EXPECT_TRUE(builder_.Build(&err));
+  ASSERT_EQ("", err);
+  // A command removed subdir after it was made, so it is made again.
+  ASSERT_EQ(3u, command_runner_.commands_ran_.size());
+  EXPECT_EQ("rm -rf subdir", command_runner_.commands_ran_[1]);
+  ASSERT_EQ(2u, fs_.directories_made_.size());
+  EXPECT_EQ("subdir", fs_.directories_made_[1]);
+  EXPECT_GT(fs_.Stat("subdir/b", &err), 0);
+}
+
 TEST_F(BuildTest, DepFileMissing) {
   string err;
   ASSERT_NO_FATAL_FAILURE(AssertParse(&state_,
@@ -1361,6 +1532,94 @@ TEST_F(BuildWithLogTest, RestatTest) {
   ASSERT_EQ(2u, command_runner_.commands_ran_.size());
 }
 
+TEST_F(BuildWithLogTest, RestatFanIn) {
+  // Many restat edges that don't change their outputs, feeding an edge
+  // whose output in turn feeds another.
+  string manifest =
+"rule true\n"
+"  command = true\n"
+"  restat = 1\n";
+  string inputs;
+  for (int i = 0; i < 20; ++i) {
+    char out[16];
+    snprintf(out, sizeof(out), "out%d", i);
+    manifest += string("build ") + out + ": true in\n";
+    inputs += string(" ") + out;
+    fs_.Create(out, "");
+  }
+  manifest += "build mid: cat" + inputs + "\n";
+  manifest += "build final: cat mid in2\n";
+  ASSERT_NO_FATAL_FAILURE(AssertParse(&state_, manifest.c_str()));
+  fs_.Create("mid", "");
+  fs_.Create("final", "");
+  fs_.Create("in2", "");
+  fs_.Tick();
+  fs_.Create("in", "");
+
+  // Pre-build so the outputs are in the build log.
+  string err;
+  EXPECT_TRUE(builder_.AddTarget("final", &err));
+  ASSERT_EQ("", err);
+  EXPECT_TRUE(builder_.Build(&err));
+  ASSERT_EQ("", err);
+  command_runner_.commands_ran_.clear();
+  state_.Reset();
+
+  fs_.Tick();
+  fs_.Create("in", "");
+  EXPECT_TRUE(builder_.AddTarget("final", &err));
+  ASSERT_EQ("", err);
+  EXPECT_TRUE(builder_.Build(&err));
+  ASSERT_EQ("", err);
+  // Only the restat edges ran; mid and final were cleaned.
+  EXPECT_EQ(20u, command_runner_.commands_ran_.size());
+}
+
+TEST_F(BuildWithLogTest, RestatPartiallyClean) {
+  // Restat edges that finish one at a time, each cleaning only some of
+  // the inputs of the edges they feed.  out keeps a dirty input and must
+  // run; out2 is cleaned once its last input is.
+  ASSERT_NO_FATAL_FAILURE(AssertParse(&state_,
+"rule true\n"
+"  command = true\n"
+"  restat = 1\n"
+"rule touch\n"
+"  command = touch $out\n"
+"  restat = 1\n"
+"build a: true in\n"
+"build b: touch in\n"
+"build c: true in\n"
+"build out: cat a b c\n"
+"build out2: cat a c\n"));
+  fs_.Create("a", "");
+  fs_.Create("b", "");
+  fs_.Create("c", "");
+  fs_.Create("out", "");
+  fs_.Create("out2", "");
+  fs_.Tick();
+  fs_.Create("in", "");
+
+  // Pre-build so the outputs are in the build log.
+  string err;
+  EXPECT_TRUE(builder_.AddTarget("out", &err));
+  EXPECT_TRUE(builder_.AddTarget("out2", &err));
+  ASSERT_EQ("", err);
+  EXPECT_TRUE(builder_.Build(&err));
+  ASSERT_EQ("", err);
+  command_runner_.commands_ran_.clear();
+  state_.Reset();
+
+  fs_.Tick();
+  fs_.Create("in", "");
+  EXPECT_TRUE(builder_.AddTarget("out", &err));
+  EXPECT_TRUE(builder_.AddTarget("out2", &err));
+  ASSERT_EQ("", err);
+  EXPECT_TRUE(builder_.Build(&err));
+  ASSERT_EQ("", err);
+  ASSERT_EQ(4u, command_runner_.commands_ran_.size());
+  EXPECT_EQ("cat a b c > out", command_runner_.commands_ran_[3]);
+}
+
 TEST_F(BuildWithLogTest, RestatMissingFile) {
   // If a restat rule doesn't create its output, and the output didn't
   // exist before the rule was run, consider that behavior equivalent
@@ -1777,6 +2036,55 @@ TEST_F(BuildTest, StatusFormatReplacePlaceholder) {
                 BuildStatus::kEdgeStarted));
 }
 
+#ifndef _WIN32
+TEST_F(BuildTest, StatusRedrawCoalescing) {
+  ASSERT_NO_FATAL_FAILURE(AssertParse(&state_,
+"build out1: cat in1\n"
+"  description = first\n"
+"build out2: cat in2\n"
+"  description = second\n"
+"build out3: cat in3\n"
+"  description = third\n"));
+  BuildConfig config;
+  BuildStatus status(config);
+  status.printer()->set_smart_terminal(true);
+  status.PlanHasTotalEdges(3);
+  status.BuildStarted();
+
+  // Failures are reported on stdout, so only check the captured output
+  // once the capture has ended.
+  int first_wait, wait, due_wait, after_wait;
+  string output, redrawn;
+  {
+    ScopedStdoutCapture capture;
+    // The first status line is drawn right away.
+    status.BuildEdgeStarted(GetNode("out1")->in_edge());
+    first_wait = status.MillisUntilRedraw();
+
+    // Within the redraw interval, only the latest line is kept.
+    status.BuildEdgeStarted(GetNode("out2")->in_edge());
+    status.BuildEdgeStarted(GetNode("out3")->in_edge());
+    wait = status.MillisUntilRedraw();
+    output = capture.Read();
+
+    usleep((wait + 5) * 1000);
+    due_wait = status.MillisUntilRedraw();
+    status.RedrawIfDue();
+    after_wait = status.MillisUntilRedraw();
+    redrawn = capture.Read().substr(output.size());
+  }
+  EXPECT_EQ(-1, first_wait);
+  EXPECT_GT(wait, 0);
+  EXPECT_NE(string::npos, output.find("first"));
+  EXPECT_EQ(string::npos, output.find("second"));
+  EXPECT_EQ(string::npos, output.find("third"));
+  EXPECT_EQ(0, due_wait);
+  EXPECT_EQ(-1, after_wait);
+  EXPECT_EQ(string::npos, redrawn.find("second"));
+  EXPECT_NE(string::npos, redrawn.find("third"));
+}
+#endif
+
 TEST_F(BuildTest, FailedDepsParse) {
   ASSERT_NO_FATAL_FAILURE(AssertParse(&state_,
 "build bad_deps.o: cat in1\n"
@@ -18,40 +18,52 @@
 #include "util.h"
 #include "metrics.h"
 
-const char kPath[] =
-    "../../third_party/WebKit/Source/WebCore/"
-    "platform/leveldb/LevelDBWriteBatch.cpp";
+// A small corpus of the kinds of paths found in manifests and depfiles.
+const char* kPaths[] = {
+  // Typical generated-file and depfile paths, already canonical.
+  "obj/third_party/WebKit/Source/core/dom/libdom.Document.o",
+  "../../third_party/WebKit/Source/WebCore/"
+      "platform/leveldb/LevelDBWriteBatch.cpp",
+  "/usr/lib/gcc/x86_64-linux-gnu/4.8/include/stddef.h",
+  // Paths that need rewriting.
+  "../../third_party/WebKit/Source/WebCore/../WebCore/"
+      "platform/./leveldb/LevelDBWriteBatch.cpp",
+  "./gen/protoc_out//chrome/common/safe_browsing/csd.pb.h",
+};
 
 int main() {
-  vector<int> times;
   string err;
 
-  char buf[200];
-  size_t len = strlen(kPath);
-  strcpy(buf, kPath);
+  for (size_t p = 0; p < sizeof(kPaths) / sizeof(kPaths[0]); ++p) {
+    vector<int> times;
+    char buf[200];
+    for (int j = 0; j < 5; ++j) {
+      const int kNumRepetitions = 2000000;
+      int64_t start = GetTimeMillis();
+      uint64_t slash_bits;
+      for (int i = 0; i < kNumRepetitions; ++i) {
+        // Start from the original path each time, so that non-canonical
+        // paths aren't measured as canonical after the first iteration.
+        size_t len = strlen(kPaths[p]);
+        memcpy(buf, kPaths[p], len + 1);
+        CanonicalizePath(buf, &len, &slash_bits, &err);
+      }
+      int delta = (int)(GetTimeMillis() - start);
+      times.push_back(delta);
+    }
 
-  for (int j = 0; j < 5; ++j) {
-    const int kNumRepetitions = 2000000;
-    int64_t start = GetTimeMillis();
-    uint64_t slash_bits;
-    for (int i = 0; i < kNumRepetitions; ++i) {
-      CanonicalizePath(buf, &len, &slash_bits, &err);
+    int min = times[0];
+    int max = times[0];
+    float total = 0;
+    for (size_t i = 0; i < times.size(); ++i) {
+      total += times[i];
+      if (times[i] < min)
+        min = times[i];
+      else if (times[i] > max)
+        max = times[i];
     }
-    int delta = (int)(GetTimeMillis() - start);
-    times.push_back(delta);
-  }
 
-  int min = times[0];
-  int max = times[0];
-  float total = 0;
-  for (size_t i = 0; i < times.size(); ++i) {
-    total += times[i];
-    if (times[i] < min)
-      min = times[i];
-    else if (times[i] > max)
-      max = times[i];
+    printf("%s\n  min %dms  max %dms  avg %.1fms\n",
+           kPaths[p], min, max, total / times.size());
   }
-
-  printf("min %dms  max %dms  avg %.1fms\n",
-         min, max, total / times.size());
 }
@@ -255,6 +255,25 @@ TEST_F(CleanTest, CleanDepFile) {
   EXPECT_EQ(2u, fs_.files_removed_.size());
 }
 
+TEST_F(CleanTest, CleanSharedDepFile) {
+  ASSERT_NO_FATAL_FAILURE(AssertParse(&state_,
+"rule cc\n"
+"  command = cc $in > $out\n"
+"  depfile = shared.d\n"
+"build out1: cc in1\n"
+"build out2: cc in2\n"
+"build out3: cc in3\n"));
+  fs_.Create("out1", "");
+  fs_.Create("out2", "");
+  fs_.Create("shared.d", "");
+
+  Cleaner cleaner(&state_, config_, &fs_);
+  EXPECT_EQ(0, cleaner.CleanAll());
+  EXPECT_EQ(3, cleaner.cleaned_files_count());
+  EXPECT_EQ(3u, fs_.files_removed_.size());
+  EXPECT_EQ(1u, fs_.files_removed_.count("shared.d"));
+}
+
 TEST_F(CleanTest, CleanDepFileOnCleanTarget) {
   ASSERT_NO_FATAL_FAILURE(AssertParse(&state_,
 "rule cc\n"
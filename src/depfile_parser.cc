@@ -15,6 +15,65 @@
 
 #include "depfile_parser.h"
 
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace {
+
+/// Return a mask with a bit set for each byte of |chunk| that is one of the
+/// characters that make up nearly all paths: [+,-./0-9:], [@A-Z], '_' and
+/// [a-z{].  These are all plain text to the parser below.
+inline unsigned int CommonPathCharMask(__m128i chunk) {
+#define IN_RANGE(lo, hi) \
+  _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8((lo) - 1)), \
+                _mm_cmplt_epi8(chunk, _mm_set1_epi8((hi) + 1)))
+  __m128i plain = _mm_or_si128(
+      _mm_or_si128(IN_RANGE('+', ':'), IN_RANGE('@', 'Z')),
+      _mm_or_si128(IN_RANGE('a', '{'),
+                   _mm_cmpeq_epi8(chunk, _mm_set1_epi8('_'))));
+#undef IN_RANGE
+  return _mm_movemask_epi8(plain);
+}
+
+/// Skip the run of common path characters starting at |in|, 16 bytes at a
+/// time, without looking at the last 15 bytes before |end|.  The parser's
+/// state machine handles whatever follows, including all escapes.
+char* SkipCommonPathChars(char* in, const char* end) {
+  while (end - in >= 16) {
+    unsigned int mask = ~CommonPathCharMask(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(in))) & 0xffff;
+    if (mask) {
+#ifdef _MSC_VER
+      unsigned long index;
+      _BitScanForward(&index, mask);
+      return in + index;
+#else
+      return in + __builtin_ctz(mask);
+#endif
+    }
+    in += 16;
+  }
+  return in;
+}
+
+}  // namespace
+
+#else
+
+namespace {
+
+char* SkipCommonPathChars(char* in, const char*) {
+  return in;
+}
+
+}  // namespace
+
+#endif
+
 // A note on backslashes in Makefiles, from reading the docs:
 // Backslash-newline is the line continuation character.
 // Backslash-# escapes a # (otherwise meaningful as a comment start).
@@ -43,6 +102,19 @@ bool DepfileParser::Parse(string* content, string* err) {
     // filename: start of the current parsed filename.
     char* filename = out;
     for (;;) {
+      // Fast path for plain path characters; this is what most of a
+      // depfile consists of.
+      char* plain_end = SkipCommonPathChars(in, end);
+      if (plain_end != in) {
+        int len = (int)(plain_end - in);
+        // Need to shift it over if we're overwriting backslashes.
+        if (out < in)
+          memmove(out, in, len);
+        out += len;
+        in = plain_end;
+        continue;
+      }
+
       // start: beginning of the current parsed span.
       const char* start = in;
       
@@ -28,6 +28,7 @@ int main(int argc, char* argv[]) {
   vector<float> times;
   for (int i = 1; i < argc; ++i) {
     const char* filename = argv[i];
+    size_t size = 0;
 
     for (int limit = 1 << 10; limit < (1<<20); limit *= 2) {
       int64_t start = GetTimeMillis();
@@ -38,6 +39,7 @@ int main(int argc, char* argv[]) {
           printf("%s: %s\n", filename, err.c_str());
           return 1;
         }
+        size = buf.size();
 
         DepfileParser parser;
         if (!parser.Parse(&buf, &err)) {
@@ -50,7 +52,7 @@ int main(int argc, char* argv[]) {
       if (end - start > 100) {
         int delta = (int)(end - start);
         float time = delta*1000 / (float)limit;
-        printf("%s: %.1fus\n", filename, time);
+        printf("%s: %.1fus (%.1f MB/s)\n", filename, time, size / time);
         times.push_back(time);
         break;
       }
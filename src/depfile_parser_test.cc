@@ -155,3 +155,23 @@ TEST_F(DepfileParserTest, RejectMultipleDifferentOutputs) {
   EXPECT_FALSE(Parse("foo bar: x y z", &err));
   ASSERT_EQ("depfile has multiple output paths", err);
 }
+
+TEST_F(DepfileParserTest, LongPathsWithEscapes) {
+  // Long runs of plain characters are consumed 16 bytes at a time; check
+  // that escapes at every offset within such runs are still de-escaped and
+  // the shifted text lands in the right place.
+  const string plain = "third_party/llvm/include/llvm/ADT/SmallVector.h";
+  for (size_t i = 0; i < plain.size(); ++i) {
+    string escaped = plain.substr(0, i) + "\\ $$" + plain.substr(i);
+    string expected = plain.substr(0, i) + " $" + plain.substr(i);
+    parser_ = DepfileParser();
+    string err;
+    EXPECT_TRUE(Parse(("out.o: " + escaped + " \\\n  " + plain +
+                       " " + escaped + "\n").c_str(), &err));
+    ASSERT_EQ("", err);
+    ASSERT_EQ(3u, parser_.ins_.size());
+    EXPECT_EQ(expected, parser_.ins_[0].AsString());
+    EXPECT_EQ(plain, parser_.ins_[1].AsString());
+    EXPECT_EQ(expected, parser_.ins_[2].AsString());
+  }
+}
@@ -15,6 +15,7 @@
 #include "deps_log.h"
 
 #include <assert.h>
+#include <algorithm>
 #include <stdio.h>
 #include <errno.h>
 #include <string.h>
@@ -30,18 +31,26 @@
 // The version is stored as 4 bytes after the signature and also serves as a
 // byte order mark. Signature and version combined are 16 bytes long.
 const char kFileSignature[] = "# ninjadeps\n";
-const int kCurrentVersion = 4;
+const int kCurrentVersion = 5;
 
 // Record size is currently limited to less than the full 32 bit, due to
 // internal buffers having to have this size.
 const unsigned kMaxRecordSize = (1 << 19) - 1;
 
+// The two high bits of the record size word give the record type.
+const unsigned kDepsRecordBit = 0x80000000;
+const unsigned kSharedDepsRecordBit = 0x40000000;
+
 DepsLog::~DepsLog() {
   Close();
+  for (ListMap::iterator i = list_ids_.begin(); i != list_ids_.end(); ++i)
+    delete [] lists_[i->second].nodes;
+  for (vector<Deps*>::iterator i = deps_.begin(); i != deps_.end(); ++i)
+    delete *i;
 }
 
 bool DepsLog::OpenForWrite(const string& path, string* err) {
-  if (needs_recompaction_) {
+  if (needs_upgrade_) {
     if (!Recompact(path, err))
       return false;
   }
@@ -51,16 +60,18 @@ bool DepsLog::OpenForWrite(const string& path, string* err) {
     *err = strerror(errno);
     return false;
   }
-  // Set the buffer size to this and flush the file buffer after every record
-  // to make sure records aren't written partially.
-  setvbuf(file_, NULL, _IOFBF, kMaxRecordSize + 1);
+  // Records are collected in |pending_| and written whole by Flush(), so
+  // the stream itself must not split them.  If a write is interrupted, the
+  // partial record at the end of the file is truncated by Load().
+  setvbuf(file_, NULL, _IONBF, 0);
   SetCloseOnExec(fileno(file_));
 
   // Opening a file in append mode doesn't set the file pointer to the file's
   // end on Windows. Do that explicitly.
   fseek(file_, 0, SEEK_END);
 
-  if (ftell(file_) == 0) {
+  file_size_ = ftell(file_);
+  if (file_size_ == 0) {
     if (fwrite(kFileSignature, sizeof(kFileSignature) - 1, 1, file_) < 1) {
       *err = strerror(errno);
       return false;
@@ -70,13 +81,27 @@ bool DepsLog::OpenForWrite(const string& path, string* err) {
       return false;
     }
   }
-  if (fflush(file_) != 0) {
-    *err = strerror(errno);
-    return false;
-  }
+  file_path_ = path;
   return true;
 }
 
+bool DepsLog::RecompactIfNeeded(string* err) {
+  if (!needs_recompaction_ || !file_)
+    return true;
+  needs_recompaction_ = false;
+
+  // Records another ninja appended since the log was opened would be lost,
+  // so leave the rewrite to a later run.  Nothing locks the file, so this
+  // doesn't protect records appended after this check.
+  if (fseek(file_, 0, SEEK_END) != 0 || ftell(file_) != file_size_)
+    return true;
+
+  string path = file_path_;
+  if (!Recompact(path, err))
+    return false;
+  return OpenForWrite(path, err);
+}
+
 bool DepsLog::RecordDeps(Node* node, TimeStamp mtime,
                          const vector<Node*>& nodes) {
   return RecordDeps(node, mtime, nodes.size(),
@@ -123,42 +148,58 @@ bool DepsLog::RecordDeps(Node* node, TimeStamp mtime,
   if (!made_change)
     return true;
 
+  // Refer to an earlier record if it has the same list of inputs.  Empty
+  // lists are shorter written out than referred to.
+  int list_id = node_count ? LookupList(node_count, nodes) : -1;
+
   // Update on-disk representation.
-  unsigned size = 4 * (1 + 2 + node_count);
+  unsigned size = list_id >= 0 ? 4 * (1 + 2 + 2) : 4 * (1 + 2 + node_count);
   if (size > kMaxRecordSize) {
     errno = ERANGE;
     return false;
   }
-  size |= 0x80000000;  // Deps record: set high bit.
-  if (fwrite(&size, 4, 1, file_) < 1)
-    return false;
+  size |= kDepsRecordBit;
+  if (list_id >= 0)
+    size |= kSharedDepsRecordBit;
+  Append(&size, 4);
   int id = node->id();
-  if (fwrite(&id, 4, 1, file_) < 1)
-    return false;
+  Append(&id, 4);
   uint32_t mtime_part = static_cast<uint32_t>(mtime & 0xffffffff);
-  if (fwrite(&mtime_part, 4, 1, file_) < 1)
-    return false;
+  Append(&mtime_part, 4);
   mtime_part = static_cast<uint32_t>((mtime >> 32) & 0xffffffff);
-  if (fwrite(&mtime_part, 4, 1, file_) < 1)
-    return false;
-  for (int i = 0; i < node_count; ++i) {
-    id = nodes[i]->id();
-    if (fwrite(&id, 4, 1, file_) < 1)
-      return false;
+  Append(&mtime_part, 4);
+  Node** shared_nodes = NULL;
+  if (list_id >= 0) {
+    Append(&list_id, 4);
+    Append(&lists_[list_id].checksum, 4);
+    shared_nodes = lists_[list_id].nodes;
+  } else if (node_count) {
+    vector<int> ids(node_count);
+    for (int i = 0; i < node_count; ++i)
+      ids[i] = nodes[i]->id();
+    Append(&ids[0], 4 * node_count);
+    shared_nodes = AddList(node_count, nodes,
+                           MurmurHash2(&ids[0], 4 * node_count));
   }
-  if (fflush(file_) != 0)
-    return false;
 
   // Update in-memory representation.
-  Deps* deps = new Deps(mtime, node_count);
-  for (int i = 0; i < node_count; ++i)
-    deps->nodes[i] = nodes[i];
-  UpdateDeps(node->id(), deps);
+  UpdateDeps(node->id(), new Deps(mtime, node_count, shared_nodes));
 
   return true;
 }
 
+bool DepsLog::Flush() {
+  if (!file_ || pending_.empty())
+    return true;
+  // One write per batch; with the file opened for append, records from
+  // other processes can only end up between batches, not inside them.
+  bool ok = fwrite(pending_.data(), pending_.size(), 1, file_) == 1;
+  pending_.clear();
+  return ok;
+}
+
 void DepsLog::Close() {
+  Flush();
   if (file_)
     fclose(file_);
   file_ = NULL;
@@ -183,8 +224,10 @@ bool DepsLog::Load(const string& path, State* state, string* err) {
   // But the v1 format could sometimes (rarely) end up with invalid data, so
   // don't migrate v1 to v3 to force a rebuild. (v2 only existed for a few days,
   // and there was no release with it, so pretend that it never happened.)
+  // v4 files are valid v5 files without shared records; they're recompacted
+  // into the new format before anything gets appended to them.
   if (!valid_header || strcmp(buf, kFileSignature) != 0 ||
-      version != kCurrentVersion) {
+      (version != kCurrentVersion && version != 4)) {
     if (version == 1)
       *err = "deps log version change; rebuilding";
     else
@@ -200,6 +243,7 @@ bool DepsLog::Load(const string& path, State* state, string* err) {
   bool read_failed = false;
   int unique_dep_record_count = 0;
   int total_dep_record_count = 0;
+  vector<Node*> list_nodes;
   for (;;) {
     offset = ftell(f);
 
@@ -209,8 +253,9 @@ bool DepsLog::Load(const string& path, State* state, string* err) {
         read_failed = true;
       break;
     }
-    bool is_deps = (size >> 31) != 0;
-    size = size & 0x7FFFFFFF;
+    bool is_deps = (size & kDepsRecordBit) != 0;
+    bool is_shared = (size & kSharedDepsRecordBit) != 0;
+    size = size & ~(kDepsRecordBit | kSharedDepsRecordBit);
 
     if (size > kMaxRecordSize || fread(buf, size, 1, f) < 1) {
       read_failed = true;
@@ -218,7 +263,12 @@ bool DepsLog::Load(const string& path, State* state, string* err) {
     }
 
     if (is_deps) {
-      assert(size % 4 == 0);
+      // Ids must refer to earlier path records.  Anything else means the
+      // file is corrupt; recover like from a truncated file.
+      if (size % 4 != 0 || size < 12) {
+        read_failed = true;
+        break;
+      }
       int* deps_data = reinterpret_cast<int*>(buf);
       int out_id = deps_data[0];
       TimeStamp mtime;
@@ -226,12 +276,39 @@ bool DepsLog::Load(const string& path, State* state, string* err) {
                           (uint64_t)(unsigned int)deps_data[1]);
       deps_data += 3;
       int deps_count = (size / 4) - 3;
+      if (!IsValidId(out_id)) {
+        read_failed = true;
+        break;
+      }
 
-      Deps* deps = new Deps(mtime, deps_count);
-      for (int i = 0; i < deps_count; ++i) {
-        assert(deps_data[i] < (int)nodes_.size());
-        assert(nodes_[deps_data[i]]);
-        deps->nodes[i] = nodes_[deps_data[i]];
+      Deps* deps;
+      if (is_shared) {
+        // Check that the referenced list is the one the writer saw.  This
+        // can only fail if two ninja processes wrote to the log concurrently.
+        int list_id = deps_data[0];
+        unsigned checksum = static_cast<unsigned>(deps_data[1]);
+        if (deps_count != 2 || list_id < 0 || list_id >= (int)lists_.size() ||
+            lists_[list_id].checksum != checksum) {
+          read_failed = true;
+          break;
+        }
+        const List& list = lists_[list_id];
+        deps = new Deps(mtime, list.node_count, list.nodes);
+      } else if (deps_count == 0) {
+        // Empty lists are stored inline and don't get a list id.
+        deps = new Deps(mtime, 0, NULL);
+      } else {
+        list_nodes.resize(deps_count);
+        int i = 0;
+        for (; i < deps_count && IsValidId(deps_data[i]); ++i)
+          list_nodes[i] = nodes_[deps_data[i]];
+        if (i < deps_count) {
+          read_failed = true;
+          break;
+        }
+        deps = new Deps(mtime, deps_count,
+                        AddList(deps_count, &list_nodes[0],
+                                MurmurHash2(deps_data, 4 * deps_count)));
       }
 
       total_dep_record_count++;
@@ -239,7 +316,11 @@ bool DepsLog::Load(const string& path, State* state, string* err) {
         ++unique_dep_record_count;
     } else {
       int path_size = size - 4;
-      assert(path_size > 0);  // CanonicalizePath() rejects empty paths.
+      // CanonicalizePath() rejects empty paths.
+      if (path_size <= 0) {
+        read_failed = true;
+        break;
+      }
       // There can be up to 3 bytes of padding.
       if (buf[path_size - 1] == '\0') --path_size;
       if (buf[path_size - 1] == '\0') --path_size;
@@ -298,6 +379,9 @@ bool DepsLog::Load(const string& path, State* state, string* err) {
       total_dep_record_count > unique_dep_record_count * kCompactionRatio) {
     needs_recompaction_ = true;
   }
+  // Shared records can't be appended to a file with the old version header.
+  if (version != kCurrentVersion)
+    needs_upgrade_ = true;
 
   return true;
 }
@@ -314,6 +398,8 @@ bool DepsLog::Recompact(const string& path, string* err) {
   METRIC_RECORD(".ninja_deps recompact");
 
   Close();
+  needs_recompaction_ = false;
+  needs_upgrade_ = false;
   string temp_path = path + ".recompact";
 
   // OpenForWrite() opens for append.  Make sure it's not appending to a
@@ -344,17 +430,31 @@ bool DepsLog::Recompact(const string& path, string* err) {
     }
   }
 
+  if (!new_log.Flush()) {
+    *err = strerror(errno);
+    new_log.Close();
+    return false;
+  }
   new_log.Close();
 
-  // All nodes now have ids that refer to new_log, so steal its data.
+  // All nodes now have ids that refer to new_log, so steal its data.  Only
+  // lists of live entries were written, so the lists of dead entries and
+  // replaced lists are freed along with new_log.
   deps_.swap(new_log.deps_);
   nodes_.swap(new_log.nodes_);
+  lists_.swap(new_log.lists_);
+  list_ids_.swap(new_log.list_ids_);
 
+#ifdef _WIN32
+  // rename() doesn't replace existing files on Windows.
   if (unlink(path.c_str()) < 0) {
     *err = strerror(errno);
     return false;
   }
+#endif
 
+  // Atomically replace the old log, so a concurrent reader never sees it
+  // missing.
   if (rename(temp_path.c_str(), path.c_str()) < 0) {
     *err = strerror(errno);
     return false;
@@ -393,23 +493,41 @@ bool DepsLog::RecordId(Node* node) {
     errno = ERANGE;
     return false;
   }
-  if (fwrite(&size, 4, 1, file_) < 1)
-    return false;
-  if (fwrite(node->path().data(), path_size, 1, file_) < 1) {
-    assert(node->path().size() > 0);
-    return false;
-  }
-  if (padding && fwrite("\0\0", padding, 1, file_) < 1)
-    return false;
+  assert(node->path().size() > 0);
+  Append(&size, 4);
+  Append(node->path().data(), path_size);
+  Append("\0\0", padding);
   int id = nodes_.size();
   unsigned checksum = ~(unsigned)id;
-  if (fwrite(&checksum, 4, 1, file_) < 1)
-    return false;
-  if (fflush(file_) != 0)
-    return false;
+  Append(&checksum, 4);
 
   node->set_id(id);
   nodes_.push_back(node);
 
   return true;
 }
+
+int DepsLog::LookupList(int node_count, Node** nodes) const {
+  StringPiece key(reinterpret_cast<const char*>(nodes),
+                  node_count * sizeof(Node*));
+  ListMap::const_iterator i = list_ids_.find(key);
+  return i == list_ids_.end() ? -1 : i->second;
+}
+
+Node** DepsLog::AddList(int node_count, Node** nodes, unsigned checksum) {
+  List list;
+  list.node_count = node_count;
+  list.checksum = checksum;
+  int id = LookupList(node_count, nodes);
+  if (id >= 0) {
+    list.nodes = lists_[id].nodes;
+  } else {
+    list.nodes = new Node*[node_count];
+    copy(nodes, nodes + node_count, list.nodes);
+    StringPiece key(reinterpret_cast<const char*>(list.nodes),
+                    node_count * sizeof(Node*));
+    list_ids_.insert(make_pair(key, (int)lists_.size()));
+  }
+  lists_.push_back(list);
+  return list.nodes;
+}
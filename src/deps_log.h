@@ -21,6 +21,7 @@ using namespace std;
 
 #include <stdio.h>
 
+#include "hash_map.h"
 #include "timestamp.h"
 
 struct Node;
@@ -48,9 +49,14 @@ struct State;
 /// Each record is either a path string or a dependency list.
 /// Numbering the path strings in file order gives them dense integer ids.
 /// A dependency list maps an output id to a list of input ids.
+/// Many outputs (e.g. the objects of one C++ library) share the exact same
+/// list of inputs, so each distinct list is only written out in full once.
+/// Numbering the full dependency records that have inputs in file order
+/// gives their input lists dense integer ids as well, which later records
+/// can refer to.  Empty lists are always written out in full.
 ///
 /// Concretely, a record is:
-///    four bytes record length, high bit indicates record type
+///    four bytes record length, two high bits indicate record type
 ///      (but max record sizes are capped at 512kB)
 ///    path records contain the string name of the path, followed by up to 3
 ///      padding bytes to align on 4 byte boundaries, followed by the
@@ -62,24 +68,35 @@ struct State;
 ///       input path id, input path id...]
 ///      (The mtime is compared against the on-disk output path mtime
 ///      to verify the stored data is up-to-date.)
+///    shared dependency records (both high bits set) are five 4-byte integers
+///      [output path id,
+///       output path mtime (lower 4 bytes), output path mtime (upper 4 bytes),
+///       list id, checksum of the input ids of that list]
+///      (The checksum detects concurrent writes like the path checksum does.)
 /// If two records reference the same output the latter one in the file
 /// wins, allowing updates to just be appended to the file.  A separate
 /// repacking step can run occasionally to remove dead records.
 struct DepsLog {
-  DepsLog() : needs_recompaction_(false), file_(NULL) {}
+  DepsLog()
+      : needs_recompaction_(false), needs_upgrade_(false), file_(NULL),
+        file_size_(0) {}
   ~DepsLog();
 
   // Writing (build-time) interface.
   bool OpenForWrite(const string& path, string* err);
   bool RecordDeps(Node* node, TimeStamp mtime, const vector<Node*>& nodes);
   bool RecordDeps(Node* node, TimeStamp mtime, int node_count, Node** nodes);
+  /// Records are buffered; they are written out by Flush() or Close().
+  bool Flush();
   void Close();
 
   // Reading (startup-time) interface.
+  /// |nodes| is owned by the DepsLog and shared between all outputs that
+  /// have the same dependency list.  It is NULL for empty lists.  Lists
+  /// that are no longer used are freed by Recompact().
   struct Deps {
-    Deps(int64_t mtime, int node_count)
-        : mtime(mtime), node_count(node_count), nodes(new Node*[node_count]) {}
-    ~Deps() { delete [] nodes; }
+    Deps(int64_t mtime, int node_count, Node** nodes)
+        : mtime(mtime), node_count(node_count), nodes(nodes) {}
     TimeStamp mtime;
     int node_count;
     Node** nodes;
@@ -90,6 +107,13 @@ struct DepsLog {
   /// Rewrite the known log entries, throwing away old data.
   bool Recompact(const string& path, string* err);
 
+  /// Rewrite the log opened by OpenForWrite() if Load() found too many
+  /// dead records in it, and continue appending to the new file.  Like
+  /// BuildLog::RecompactIfNeeded(), this is skipped if anything was
+  /// appended to the log since it was opened, but records another ninja
+  /// appends while the log is being rewritten are lost.
+  bool RecompactIfNeeded(string* err);
+
   /// Returns if the deps entry for a node is still reachable from the manifest.
   ///
   /// The deps log can contain deps entries for files that were built in the
@@ -101,6 +125,7 @@ struct DepsLog {
   /// Used for tests.
   const vector<Node*>& nodes() const { return nodes_; }
   const vector<Deps*>& deps() const { return deps_; }
+  size_t list_count() const { return lists_.size(); }
 
  private:
   // Updates the in-memory representation.  Takes ownership of |deps|.
@@ -108,14 +133,46 @@ struct DepsLog {
   bool UpdateDeps(int out_id, Deps* deps);
   // Write a node name record, assigning it an id.
   bool RecordId(Node* node);
+  // Buffer record bytes until the next Flush().
+  void Append(const void* data, size_t size) {
+    pending_.append(static_cast<const char*>(data), size);
+  }
+  // Whether |id| refers to a node record that has been read.
+  bool IsValidId(int id) const { return id >= 0 && id < (int)nodes_.size(); }
+  // Returns the id of the list with the given contents, or -1.
+  int LookupList(int node_count, Node** nodes) const;
+  // Assign the next list id to a copy of |nodes|, sharing storage with
+  // an identical earlier list if there is one.  Returns the shared copy.
+  Node** AddList(int node_count, Node** nodes, unsigned checksum);
+
+  /// A dependency list and the checksum of its on-disk input ids.
+  struct List {
+    int node_count;
+    Node** nodes;
+    unsigned checksum;
+  };
 
   bool needs_recompaction_;
+  /// Whether the log file has an old version and must be rewritten
+  /// before anything is appended to it.
+  bool needs_upgrade_;
   FILE* file_;
+  /// Records not written out by Flush() yet.
+  string pending_;
+  string file_path_;
+  /// Size of the log file when it was opened for writing.
+  long file_size_;
 
   /// Maps id -> Node.
   vector<Node*> nodes_;
   /// Maps id -> deps of that id.
   vector<Deps*> deps_;
+  /// Maps list id -> list.
+  vector<List> lists_;
+  /// Maps the bytes of a Node* array -> id of the first list with it.
+  /// The keys point into the storage of these lists, which is owned here.
+  typedef ExternalStringHashMap<int>::Type ListMap;
+  ListMap list_ids_;
 
   friend struct DepsLogTest;
 };
@@ -166,6 +166,125 @@ TEST_F(DepsLogTest, DoubleEntry) {
   }
 }
 
+// Verify that identical dependency lists are only stored once.
+TEST_F(DepsLogTest, SharedLists) {
+  const int kOutputs = 100;
+  const int kHeaders = 50;
+
+  // Record the same headers for many outputs, and one differing list.
+  {
+    State state;
+    DepsLog log;
+    string err;
+    EXPECT_TRUE(log.OpenForWrite(kTestFilename, &err));
+    ASSERT_EQ("", err);
+
+    vector<Node*> deps;
+    for (int i = 0; i < kHeaders; ++i) {
+      char buf[32];
+      sprintf(buf, "header%d.h", i);
+      deps.push_back(state.GetNode(buf, 0));
+    }
+    for (int i = 0; i < kOutputs; ++i) {
+      char buf[32];
+      sprintf(buf, "out%d.o", i);
+      log.RecordDeps(state.GetNode(buf, 0), i, deps);
+    }
+    deps.pop_back();
+    log.RecordDeps(state.GetNode("other.o", 0), 1, deps);
+
+    // Outputs with the same list share its storage.
+    EXPECT_EQ(log.GetDeps(state.GetNode("out0.o", 0))->nodes,
+              log.GetDeps(state.GetNode("out1.o", 0))->nodes);
+    EXPECT_NE(log.GetDeps(state.GetNode("out0.o", 0))->nodes,
+              log.GetDeps(state.GetNode("other.o", 0))->nodes);
+    log.Close();
+
+    // Every list beyond the first two is a fixed size reference.
+    struct stat st;
+    ASSERT_EQ(0, stat(kTestFilename, &st));
+    ASSERT_LT((int)st.st_size, 4 * (kHeaders + 3) * 3 + 24 * kOutputs +
+                               40 * (kHeaders + kOutputs + 1));
+  }
+
+  {
+    State state;
+    DepsLog log;
+    string err;
+    EXPECT_TRUE(log.Load(kTestFilename, &state, &err));
+    ASSERT_EQ("", err);
+
+    for (int i = 0; i < kOutputs; ++i) {
+      char buf[32];
+      sprintf(buf, "out%d.o", i);
+      DepsLog::Deps* deps = log.GetDeps(state.GetNode(buf, 0));
+      ASSERT_TRUE(deps);
+      EXPECT_EQ(i, deps->mtime);
+      ASSERT_EQ(kHeaders, deps->node_count);
+      EXPECT_EQ("header0.h", deps->nodes[0]->path());
+      EXPECT_EQ("header49.h", deps->nodes[kHeaders - 1]->path());
+    }
+    DepsLog::Deps* deps = log.GetDeps(state.GetNode("other.o", 0));
+    ASSERT_TRUE(deps);
+    ASSERT_EQ(kHeaders - 1, deps->node_count);
+    EXPECT_EQ("header48.h", deps->nodes[kHeaders - 2]->path());
+  }
+}
+
+TEST_F(DepsLogTest, SharedListsRecompact) {
+  const char kManifest[] =
+"rule cc\n"
+"  command = cc\n"
+"  deps = gcc\n"
+"build a.o: cc\n"
+"build b.o: cc\n"
+"build c.o: cc\n";
+
+  State state;
+  ASSERT_NO_FATAL_FAILURE(AssertParse(&state, kManifest));
+  DepsLog log;
+  string err;
+  ASSERT_TRUE(log.OpenForWrite(kTestFilename, &err));
+  ASSERT_EQ("", err);
+
+  // Empty lists aren't shared.
+  vector<Node*> deps;
+  log.RecordDeps(state.GetNode("c.o", 0), 1, deps);
+  EXPECT_EQ(0u, log.list_count());
+  EXPECT_EQ(0, log.GetDeps(state.GetNode("c.o", 0))->node_count);
+
+  deps.push_back(state.GetNode("foo.h", 0));
+  log.RecordDeps(state.GetNode("a.o", 0), 1, deps);
+  log.RecordDeps(state.GetNode("b.o", 0), 1, deps);
+  deps.push_back(state.GetNode("bar.h", 0));
+  log.RecordDeps(state.GetNode("a.o", 0), 2, deps);
+  log.RecordDeps(state.GetNode("b.o", 0), 2, deps);
+  deps.push_back(state.GetNode("baz.h", 0));
+  log.RecordDeps(state.GetNode("gone.o", 0), 2, deps);
+  EXPECT_EQ(3u, log.list_count());
+
+  // Only the list a.o and b.o now share is still used.
+  ASSERT_TRUE(log.Recompact(kTestFilename, &err));
+  ASSERT_EQ("", err);
+  EXPECT_EQ(1u, log.list_count());
+  ASSERT_EQ(2, log.GetDeps(state.GetNode("b.o", 0))->node_count);
+  EXPECT_EQ(log.GetDeps(state.GetNode("a.o", 0))->nodes,
+            log.GetDeps(state.GetNode("b.o", 0))->nodes);
+  EXPECT_EQ(0, log.GetDeps(state.GetNode("c.o", 0))->node_count);
+  EXPECT_FALSE(log.GetDeps(state.GetNode("gone.o", 0)));
+
+  // The rewritten log loads back the same way.
+  State state2;
+  ASSERT_NO_FATAL_FAILURE(AssertParse(&state2, kManifest));
+  DepsLog log2;
+  ASSERT_TRUE(log2.Load(kTestFilename, &state2, &err));
+  ASSERT_EQ("", err);
+  EXPECT_EQ(1u, log2.list_count());
+  EXPECT_EQ(0, log2.GetDeps(state2.GetNode("c.o", 0))->node_count);
+  ASSERT_EQ(2, log2.GetDeps(state2.GetNode("a.o", 0))->node_count);
+  EXPECT_EQ("bar.h", log2.GetDeps(state2.GetNode("a.o", 0))->nodes[1]->path());
+}
+
 // Verify that adding the new deps works and can be compacted away.
 TEST_F(DepsLogTest, Recompact) {
   const char kManifest[] =
@@ -476,4 +595,51 @@ TEST_F(DepsLogTest, TruncatedRecovery) {
   }
 }
 
+// Records with ids that don't refer to a node record are treated like a
+// truncated file instead of crashing.
+TEST_F(DepsLogTest, InvalidId) {
+  {
+    State state;
+    DepsLog log;
+    string err;
+    EXPECT_TRUE(log.OpenForWrite(kTestFilename, &err));
+    ASSERT_EQ("", err);
+
+    vector<Node*> deps;
+    deps.push_back(state.GetNode("foo.h", 0));
+    log.RecordDeps(state.GetNode("out.o", 0), 1, deps);
+
+    // Nothing is written before the records are flushed.
+    struct stat st;
+    ASSERT_EQ(0, stat(kTestFilename, &st));
+    int header_size = st.st_size;
+    ASSERT_TRUE(log.Flush());
+    ASSERT_EQ(0, stat(kTestFilename, &st));
+    ASSERT_GT(st.st_size, header_size);
+    log.Close();
+  }
+
+  // Append a deps record for out.o that refers to a non-existent node.
+  {
+    FILE* f = fopen(kTestFilename, "ab");
+    ASSERT_TRUE(f);
+    int record[] = { 4 * 4, 0, 2, 0, 1000 };
+    record[0] |= 0x80000000;  // Mark as a deps record.
+    ASSERT_EQ(1u, fwrite(record, sizeof(record), 1, f));
+    fclose(f);
+  }
+
+  State state;
+  DepsLog log;
+  string err;
+  EXPECT_TRUE(log.Load(kTestFilename, &state, &err));
+  ASSERT_EQ("premature end of file; recovering", err);
+
+  DepsLog::Deps* deps = log.GetDeps(state.GetNode("out.o", 0));
+  ASSERT_TRUE(deps);
+  EXPECT_EQ(1, deps->mtime);
+  ASSERT_EQ(1, deps->node_count);
+  EXPECT_EQ("foo.h", deps->nodes[0]->path());
+}
+
 }  // anonymous namespace
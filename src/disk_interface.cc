@@ -31,8 +31,6 @@
 #include "metrics.h"
 #include "util.h"
 
-namespace {
-
 string DirName(const string& path) {
 #ifdef _WIN32
   const char kPathSeparators[] = "\\/";
@@ -49,6 +47,8 @@ string DirName(const string& path) {
   return path.substr(0, slash_pos);
 }
 
+namespace {
+
 int MakeDir(const string& path) {
 #ifdef _WIN32
   return _mkdir(path.c_str());
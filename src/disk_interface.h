@@ -21,6 +21,10 @@ using namespace std;
 
 #include "timestamp.h"
 
+/// @return the directory part of \a path, without trailing separators, or
+/// an empty string if it has none.
+string DirName(const string& path);
+
 /// Interface for reading files from disk.  See DiskInterface for details.
 /// This base offers the minimum interface needed just to read files.
 struct FileReader {
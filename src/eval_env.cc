@@ -13,20 +13,123 @@
 // limitations under the License.
 
 #include <assert.h>
+#include <algorithm>
 
 #include "eval_env.h"
 
-string BindingEnv::LookupVariable(const string& var) {
-  map<string, string>::iterator i = bindings_.find(var);
-  if (i != bindings_.end())
+namespace {
+
+/// A pooled string and the number of references to it.
+struct PooledString {
+  explicit PooledString(StringPiece str) : str_(str.AsString()), refs_(0) {}
+  string str_;
+  size_t refs_;
+};
+
+typedef ExternalStringHashMap<PooledString*>::Type Pool;
+
+Pool* GetPool() {
+  static Pool* pool = new Pool;
+  return pool;
+}
+
+struct BindingNameLess {
+  bool operator()(const pair<string, const string*>& binding,
+                  const string& name) const {
+    return binding.first < name;
+  }
+};
+
+}  // namespace
+
+// static
+const string* StringPool::Acquire(StringPiece str) {
+  Pool* pool = GetPool();
+  Pool::iterator i = pool->find(str);
+  if (i == pool->end()) {
+    PooledString* pooled = new PooledString(str);
+    i = pool->insert(make_pair(StringPiece(pooled->str_), pooled)).first;
+  }
+  ++i->second->refs_;
+  return &i->second->str_;
+}
+
+// static
+void StringPool::Release(const string* str) {
+  Pool* pool = GetPool();
+  Pool::iterator i = pool->find(*str);
+  assert(i != pool->end() && &i->second->str_ == str);
+  if (--i->second->refs_ == 0) {
+    PooledString* pooled = i->second;
+    pool->erase(i);
+    delete pooled;
+  }
+}
+
+BindingEnv::~BindingEnv() {
+  if (binding_map_) {
+    for (BindingMap::iterator i = binding_map_->begin();
+         i != binding_map_->end(); ++i) {
+      StringPool::Release(i->second.first);
+      StringPool::Release(i->second.second);
+    }
+    delete binding_map_;
+  }
+  for (Bindings::iterator i = bindings_.begin(); i != bindings_.end(); ++i)
+    StringPool::Release(i->second);
+}
+
+const string* BindingEnv::LookupBindingCurrentScope(const string& var) const {
+  if (binding_map_) {
+    BindingMap::const_iterator i = binding_map_->find(var);
+    return i != binding_map_->end() ? i->second.second : NULL;
+  }
+  Bindings::const_iterator i = lower_bound(bindings_.begin(), bindings_.end(),
+                                           var, BindingNameLess());
+  if (i != bindings_.end() && i->first == var)
     return i->second;
+  return NULL;
+}
+
+string BindingEnv::LookupVariable(const string& var) {
+  if (const string* val = LookupBindingCurrentScope(var))
+    return *val;
   if (parent_)
     return parent_->LookupVariable(var);
   return "";
 }
 
 void BindingEnv::AddBinding(const string& key, const string& val) {
-  bindings_[key] = val;
+  const string* pooled_val = StringPool::Acquire(val);
+  if (!binding_map_) {
+    Bindings::iterator i = lower_bound(bindings_.begin(), bindings_.end(),
+                                       key, BindingNameLess());
+    if (i != bindings_.end() && i->first == key) {
+      StringPool::Release(i->second);
+      i->second = pooled_val;
+      return;
+    }
+    if (bindings_.size() < kMaxFlatBindings) {
+      bindings_.insert(i, make_pair(key, pooled_val));
+      return;
+    }
+
+    binding_map_ = new BindingMap;
+    for (i = bindings_.begin(); i != bindings_.end(); ++i) {
+      const string* pooled_key = StringPool::Acquire(i->first);
+      (*binding_map_)[*pooled_key] = make_pair(pooled_key, i->second);
+    }
+    Bindings().swap(bindings_);
+  }
+
+  BindingMap::iterator i = binding_map_->find(key);
+  if (i != binding_map_->end()) {
+    StringPool::Release(i->second.second);
+    i->second.second = pooled_val;
+    return;
+  }
+  const string* pooled_key = StringPool::Acquire(key);
+  (*binding_map_)[*pooled_key] = make_pair(pooled_key, pooled_val);
 }
 
 void BindingEnv::AddRule(const Rule* rule) {
@@ -82,9 +185,8 @@ const map<string, const Rule*>& BindingEnv::GetRules() const {
 string BindingEnv::LookupWithFallback(const string& var,
                                       const EvalString* eval,
                                       Env* env) {
-  map<string, string>::iterator i = bindings_.find(var);
-  if (i != bindings_.end())
-    return i->second;
+  if (const string* val = LookupBindingCurrentScope(var))
+    return *val;
 
   if (eval)
     return eval->Evaluate(env);
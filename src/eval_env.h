@@ -20,10 +20,23 @@
 #include <vector>
 using namespace std;
 
+#include "hash_map.h"
 #include "string_piece.h"
 
 struct Rule;
 
+/// A process-wide pool of immutable, reference counted strings.
+/// Generators repeat the same flags, defines and include lists on
+/// thousands of build statements; pooling them stores each distinct value
+/// once.  A pooled string is freed when its last reference is released.
+struct StringPool {
+  /// Return the unique pooled copy of |str|, taking a reference to it.
+  static const string* Acquire(StringPiece str);
+
+  /// Release a reference taken by Acquire().
+  static void Release(const string* str);
+};
+
 /// An interface for a scope for variable (e.g. "$foo") lookups.
 struct Env {
   virtual ~Env() {}
@@ -75,10 +88,11 @@ struct Rule {
 /// An Env which contains a mapping of variables to values
 /// as well as a pointer to a parent scope.
 struct BindingEnv : public Env {
-  BindingEnv() : parent_(NULL) {}
-  explicit BindingEnv(BindingEnv* parent) : parent_(parent) {}
+  BindingEnv() : binding_map_(NULL), parent_(NULL) {}
+  explicit BindingEnv(BindingEnv* parent)
+      : binding_map_(NULL), parent_(parent) {}
 
-  virtual ~BindingEnv() {}
+  virtual ~BindingEnv();
   virtual string LookupVariable(const string& var);
 
   void AddRule(const Rule* rule);
@@ -97,9 +111,27 @@ struct BindingEnv : public Env {
                             Env* env);
 
 private:
-  map<string, string> bindings_;
+  /// Return the value bound to |var| in this scope, or NULL.
+  const string* LookupBindingCurrentScope(const string& var) const;
+
+  /// Bindings of this scope; values are pooled in StringPool.  Most
+  /// scopes hold only a handful of bindings, so they are kept in a flat
+  /// vector sorted by name, which is both smaller and faster than a map.
+  /// Once a scope, like the top level of a large manifest, grows past
+  /// kMaxFlatBindings, they move to |binding_map_|, keyed by pooled names,
+  /// so that adding one doesn't cost a linear insert.
+  typedef vector<pair<string, const string*> > Bindings;
+  Bindings bindings_;
+  typedef ExternalStringHashMap<pair<const string*, const string*> >::Type
+      BindingMap;
+  BindingMap* binding_map_;
+  static const size_t kMaxFlatBindings = 32;
   map<string, const Rule*> rules_;
   BindingEnv* parent_;
+
+  // Unimplemented copy ctor and operator= ensure we don't copy the map.
+  BindingEnv(const BindingEnv& other);        // DO NOT IMPLEMENT
+  void operator=(const BindingEnv& other);    // DO NOT IMPLEMENT
 };
 
 #endif  // NINJA_EVAL_ENV_H_
@@ -0,0 +1,88 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "eval_env.h"
+
+#include "test.h"
+
+TEST(StringPool, Shared) {
+  string flags = "-O2 -g";
+  const string* a = StringPool::Acquire("-O2 -g");
+  const string* b = StringPool::Acquire(flags);
+  const string* c = StringPool::Acquire("-O2");
+  EXPECT_EQ(a, b);
+  EXPECT_NE(a, c);
+  EXPECT_EQ("-O2 -g", *a);
+
+  // The string stays valid while any reference to it is held.
+  StringPool::Release(a);
+  EXPECT_EQ("-O2 -g", *b);
+  StringPool::Release(b);
+  StringPool::Release(c);
+}
+
+TEST(BindingEnvTest, Bindings) {
+  BindingEnv env;
+  env.AddBinding("cflags", "-O2");
+  env.AddBinding("b", "1");
+  env.AddBinding("z", "2");
+  env.AddBinding("cflags", "-O0");
+  EXPECT_EQ("-O0", env.LookupVariable("cflags"));
+  EXPECT_EQ("1", env.LookupVariable("b"));
+  EXPECT_EQ("2", env.LookupVariable("z"));
+  EXPECT_EQ("", env.LookupVariable("a"));
+}
+
+TEST(BindingEnvTest, SharedValues) {
+  BindingEnv parent;
+  BindingEnv* first = new BindingEnv(&parent);
+  BindingEnv second(&parent);
+  first->AddBinding("cflags", "-O2 -g");
+  second.AddBinding("cflags", "-O2 -g");
+  second.AddBinding("defines", "-O2 -g");
+
+  // Dropping one scope leaves the value in the others.
+  delete first;
+  EXPECT_EQ("-O2 -g", second.LookupVariable("cflags"));
+  EXPECT_EQ("-O2 -g", second.LookupVariable("defines"));
+  second.AddBinding("cflags", "-O0");
+  EXPECT_EQ("-O0", second.LookupVariable("cflags"));
+  EXPECT_EQ("-O2 -g", second.LookupVariable("defines"));
+}
+
+TEST(BindingEnvTest, ManyBindings) {
+  const string* name = StringPool::Acquire("var42");
+  {
+    // Large scopes move from the flat vector to a hash map keyed by
+    // pooled names.
+    BindingEnv env;
+    for (int i = 0; i < 100; ++i) {
+      char key[16], val[16];
+      snprintf(key, sizeof(key), "var%d", i);
+      snprintf(val, sizeof(val), "%d", i);
+      env.AddBinding(key, val);
+    }
+    env.AddBinding("var7", "seven");
+    EXPECT_EQ("0", env.LookupVariable("var0"));
+    EXPECT_EQ("seven", env.LookupVariable("var7"));
+    EXPECT_EQ("99", env.LookupVariable("var99"));
+    EXPECT_EQ("", env.LookupVariable("var100"));
+  }
+
+  // The scope shared the pooled name and released only its own references.
+  EXPECT_EQ("var42", *name);
+  EXPECT_EQ(name, StringPool::Acquire("var42"));
+  StringPool::Release(name);
+  StringPool::Release(name);
+}
@@ -32,6 +32,7 @@ bool Node::Stat(DiskInterface* disk_interface, string* err) {
 }
 
 bool DependencyScan::RecomputeDirty(Node* node, string* err) {
+  METRIC_RECORD("dependency scan");
   vector<Node*> stack;
   return RecomputeDirty(node, &stack, err);
 }
@@ -182,10 +183,9 @@ bool DependencyScan::VerifyDAG(Node* node, vector<Node*>* stack, string* err) {
 
 bool DependencyScan::RecomputeOutputsDirty(Edge* edge, Node* most_recent_input,
                                            bool* outputs_dirty, string* err) {
-  string command = edge->EvaluateCommand(/*incl_rsp_file=*/true);
   for (vector<Node*>::iterator o = edge->outputs_.begin();
        o != edge->outputs_.end(); ++o) {
-    if (RecomputeOutputDirty(edge, most_recent_input, command, *o)) {
+    if (RecomputeOutputDirty(edge, most_recent_input, *o)) {
       *outputs_dirty = true;
       return true;
     }
@@ -195,7 +195,6 @@ bool DependencyScan::RecomputeOutputsDirty(Edge* edge, Node* most_recent_input,
 
 bool DependencyScan::RecomputeOutputDirty(Edge* edge,
                                           Node* most_recent_input,
-                                          const string& command,
                                           Node* output) {
   if (edge->is_phony()) {
     // Phony edges don't write any output.  Outputs are only dirty if
@@ -244,8 +243,7 @@ bool DependencyScan::RecomputeOutputDirty(Edge* edge,
   if (build_log()) {
     bool generator = edge->GetBindingBool("generator");
     if (entry || (entry = build_log()->LookupByOutput(output->path()))) {
-      if (!generator &&
-          BuildLog::LogEntry::HashCommand(command) != entry->command_hash) {
+      if (!generator && edge->GetCommandHash() != entry->command_hash) {
         // May also be dirty due to the command changing since the last build.
         // But if this is a generator rule, the command changing does not make us
         // dirty.
@@ -341,32 +339,68 @@ string EdgeEnv::LookupVariable(const string& var) {
 string EdgeEnv::MakePathList(vector<Node*>::iterator begin,
                              vector<Node*>::iterator end,
                              char sep) {
+  // Lists can have tens of thousands of paths; size the result for the
+  // usual case that none of them needs escaping.
+  size_t size = 0;
+  for (vector<Node*>::iterator i = begin; i != end; ++i)
+    size += (*i)->path().size() + 1;
   string result;
+  result.reserve(size);
+
+  string decanonicalized;
   for (vector<Node*>::iterator i = begin; i != end; ++i) {
     if (!result.empty())
       result.push_back(sep);
-    const string& path = (*i)->PathDecanonicalized();
+    // Only copy paths whose slashes need to be changed back.
+    const string* path = &(*i)->path();
+    if ((*i)->slash_bits()) {
+      decanonicalized = (*i)->PathDecanonicalized();
+      path = &decanonicalized;
+    }
     if (escape_in_out_ == kShellEscape) {
 #if _WIN32
-      GetWin32EscapedString(path, &result);
+      GetWin32EscapedString(*path, &result);
 #else
-      GetShellEscapedString(path, &result);
+      GetShellEscapedString(*path, &result);
 #endif
     } else {
-      result.append(path);
+      result.append(*path);
     }
   }
   return result;
 }
 
+/// The string EvaluateCommand(true) returns, and whose hash the build log
+/// records: the command, followed by the response file contents if any.
+static string CommandWithRspfile(const string& command,
+                                 const string& rspfile_content) {
+  if (rspfile_content.empty())
+    return command;
+  return command + ";rspfile=" + rspfile_content;
+}
+
 string Edge::EvaluateCommand(bool incl_rsp_file) {
-  string command = GetBinding("command");
-  if (incl_rsp_file) {
-    string rspfile_content = GetBinding("rspfile_content");
-    if (!rspfile_content.empty())
-      command += ";rspfile=" + rspfile_content;
+  if (!incl_rsp_file)
+    return GetBinding("command");
+  return CommandWithRspfile(GetBinding("command"),
+                            GetBinding("rspfile_content"));
+}
+
+uint64_t Edge::GetCommandHash() {
+  if (!command_hash_valid_) {
+    command_hash_ = BuildLog::LogEntry::HashCommand(EvaluateCommand(true));
+    command_hash_valid_ = true;
   }
-  return command;
+  return command_hash_;
+}
+
+void Edge::PrimeCommandHash(const string& command,
+                            const string& rspfile_content) {
+  if (command_hash_valid_)
+    return;
+  command_hash_ = BuildLog::LogEntry::HashCommand(
+      CommandWithRspfile(command, rspfile_content));
+  command_hash_valid_ = true;
 }
 
 string Edge::GetBinding(const string& key) {
@@ -136,6 +136,7 @@ struct Edge {
 
   Edge() : rule_(NULL), pool_(NULL), env_(NULL), mark_(VisitNone),
            outputs_ready_(false), deps_missing_(false),
+           command_hash_(0), command_hash_valid_(false), id_(0),
            implicit_deps_(0), order_only_deps_(0), implicit_outs_(0) {}
 
   /// Return true if all inputs' in-edges are ready.
@@ -146,6 +147,15 @@ struct Edge {
   /// full contents of a response file (if applicable)
   string EvaluateCommand(bool incl_rsp_file = false);
 
+  /// Return the hash of EvaluateCommand(true) as recorded in the build log.
+  /// The command of an edge can't change once the manifest is loaded, so
+  /// the hash is computed on first use and cached afterwards.
+  uint64_t GetCommandHash();
+
+  /// Compute the hash GetCommandHash() returns from the edge's already
+  /// evaluated command and "rspfile_content" binding, unless it is known.
+  void PrimeCommandHash(const string& command, const string& rspfile_content);
+
   /// Returns the shell-escaped value of |key|.
   string GetBinding(const string& key);
   bool GetBindingBool(const string& key);
@@ -165,6 +175,12 @@ struct Edge {
   VisitMark mark_;
   bool outputs_ready_;
   bool deps_missing_;
+  uint64_t command_hash_;
+  bool command_hash_valid_;
+
+  /// A dense integer id for the edge, its index in State::edges_.
+  /// Used by Plan to keep per-edge state in flat arrays.
+  size_t id_;
 
   const Rule& rule() const { return *rule_; }
   Pool* pool() const { return pool_; }
@@ -284,7 +300,7 @@ struct DependencyScan {
   /// Recompute whether a given single output should be marked dirty.
   /// Returns true if so.
   bool RecomputeOutputDirty(Edge* edge, Node* most_recent_input,
-                            const string& command, Node* output);
+                            Node* output);
 
   BuildLog* build_log_;
   DiskInterface* disk_interface_;
@@ -14,6 +14,7 @@
 
 #include "graph.h"
 #include "build.h"
+#include "build_log.h"
 
 #include "test.h"
 
@@ -227,6 +228,42 @@ TEST_F(GraphTest, VarInOutPathEscaping) {
 #endif
 }
 
+// Check that the cached command hash covers the rspfile content, matching
+// what the build log records.
+TEST_F(GraphTest, CommandHash) {
+  ASSERT_NO_FATAL_FAILURE(AssertParse(&state_,
+"rule r\n"
+"  command = cat $rspfile > $out\n"
+"  rspfile = $out.rsp\n"
+"  rspfile_content = $in\n"
+"build out: r in\n"));
+  Edge* edge = GetNode("out")->in_edge();
+  uint64_t expected =
+      BuildLog::LogEntry::HashCommand("cat out.rsp > out;rspfile=in");
+  EXPECT_EQ(expected, edge->GetCommandHash());
+  // A second lookup is served from the cache.
+  EXPECT_EQ(expected, edge->GetCommandHash());
+}
+
+TEST_F(GraphTest, PrimeCommandHash) {
+  ASSERT_NO_FATAL_FAILURE(AssertParse(&state_,
+"rule r\n"
+"  command = cat $rspfile > $out\n"
+"  rspfile = $out.rsp\n"
+"  rspfile_content = $in\n"
+"build out: r in\n"
+"build out2: cat in\n"));
+  Edge* edge = GetNode("out")->in_edge();
+  edge->PrimeCommandHash("cat out.rsp > out", "in");
+  EXPECT_EQ(BuildLog::LogEntry::HashCommand("cat out.rsp > out;rspfile=in"),
+            edge->GetCommandHash());
+
+  edge = GetNode("out2")->in_edge();
+  edge->PrimeCommandHash("cat in > out2", "");
+  EXPECT_EQ(BuildLog::LogEntry::HashCommand("cat in > out2"),
+            edge->GetCommandHash());
+}
+
 // Regression test for https://github.com/ninja-build/ninja/issues/380
 TEST_F(GraphTest, DepfileWithCanonicalizablePath) {
   ASSERT_NO_FATAL_FAILURE(AssertParse(&state_,
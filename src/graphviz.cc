@@ -17,64 +17,291 @@
 #include <stdio.h>
 #include <algorithm>
 
+#include "build_log.h"
 #include "graph.h"
+#include "json.h"
+
+namespace {
+
+string XMLEscape(const string& text) {
+  string result;
+  for (string::const_iterator c = text.begin(); c != text.end(); ++c) {
+    switch (*c) {
+      case '&': result += "&amp;"; break;
+      case '<': result += "&lt;"; break;
+      case '>': result += "&gt;"; break;
+      case '"': result += "&quot;"; break;
+      default: result += *c; break;
+    }
+  }
+  return result;
+}
+
+/// Escape \a text for use inside a double-quoted DOT string.
+string DotEscape(const string& text) {
+  string result;
+  for (string::const_iterator c = text.begin(); c != text.end(); ++c) {
+    if (*c == '"' || *c == '\\')
+      result += '\\';
+    result += *c;
+  }
+  return result;
+}
+
+string DisplayPath(Node* node) {
+  string path = node->path();
+  replace(path.begin(), path.end(), '\\', '/');
+  return path;
+}
+
+}  // namespace
+
+GraphViz::GraphViz()
+    : format_(DOT), max_depth_(0), collapse_headers_(false),
+      cluster_dirs_(false), min_cost_ms_(0), build_log_(NULL),
+      out_file_(stdout) {}
 
 void GraphViz::AddTarget(Node* node) {
-  if (visited_nodes_.find(node) != visited_nodes_.end())
-    return;
-
-  string pathstr = node->path();
-  replace(pathstr.begin(), pathstr.end(), '\\', '/');
-  printf("\"%p\" [label=\"%s\"]\n", node, pathstr.c_str());
-  visited_nodes_.insert(node);
-
-  Edge* edge = node->in_edge();
-
-  if (!edge) {
-    // Leaf node.
-    // Draw as a rect?
-    return;
-  }
-
-  if (visited_edges_.find(edge) != visited_edges_.end())
-    return;
-  visited_edges_.insert(edge);
-
-  if (edge->inputs_.size() == 1 && edge->outputs_.size() == 1) {
-    // Can draw simply.
-    // Note extra space before label text -- this is cosmetic and feels
-    // like a graphviz bug.
-    printf("\"%p\" -> \"%p\" [label=\" %s\"]\n",
-           edge->inputs_[0], edge->outputs_[0], edge->rule_->name().c_str());
-  } else {
-    printf("\"%p\" [label=\"%s\", shape=ellipse]\n",
-           edge, edge->rule_->name().c_str());
+  targets_.push_back(node);
+}
+
+bool GraphViz::IsExcluded(Node* node) const {
+  for (vector<string>::const_iterator p = exclude_paths_.begin();
+       p != exclude_paths_.end(); ++p) {
+    if (node->path().find(*p) != string::npos)
+      return true;
+  }
+  return false;
+}
+
+bool GraphViz::ShouldExpand(Edge* edge, int depth) const {
+  if (max_depth_ > 0 && depth >= max_depth_)
+    return false;
+  if (skip_rules_.count(edge->rule().name()))
+    return false;
+  if (min_cost_ms_ > 0 && build_log_ && !edge->is_phony()) {
+    // Any output's entry has the cost of the edge's last run.  Edges that
+    // were never run have no known cost and are kept.
+    for (vector<Node*>::iterator out = edge->outputs_.begin();
+         out != edge->outputs_.end(); ++out) {
+      BuildLog::LogEntry* entry = build_log_->LookupByOutput((*out)->path());
+      if (entry)
+        return entry->end_time - entry->start_time >= min_cost_ms_;
+    }
+  }
+  return true;
+}
+
+bool GraphViz::Visit(Node* node, int depth) {
+  if (node_ids_.count(node))
+    return true;
+  if (IsExcluded(node))
+    return false;
+  node_ids_[node] = (int)nodes_.size();
+  nodes_.push_back(node);
+  queue_.push_back(make_pair(node, depth));
+  return true;
+}
+
+void GraphViz::Walk() {
+  for (vector<Node*>::iterator t = targets_.begin(); t != targets_.end(); ++t)
+    Visit(*t, 0);
+
+  for (size_t i = 0; i < queue_.size(); ++i) {
+    Node* node = queue_[i].first;
+    int depth = queue_[i].second;
+    Edge* edge = node->in_edge();
+    if (!edge || visited_edges_.count(edge) || !ShouldExpand(edge, depth))
+      continue;
+    visited_edges_.insert(edge);
+
+    DrawnEdge drawn;
+    drawn.edge = edge;
     for (vector<Node*>::iterator out = edge->outputs_.begin();
          out != edge->outputs_.end(); ++out) {
-      printf("\"%p\" -> \"%p\"\n", edge, *out);
+      if (Visit(*out, depth))
+        drawn.outputs.push_back(*out);
     }
-    for (vector<Node*>::iterator in = edge->inputs_.begin();
-         in != edge->inputs_.end(); ++in) {
-      const char* order_only = "";
-      if (edge->is_order_only(in - edge->inputs_.begin()))
-        order_only = " style=dotted";
-      printf("\"%p\" -> \"%p\" [arrowhead=none%s]\n", (*in), edge, order_only);
+    for (size_t in = 0; in < edge->inputs_.size(); ++in) {
+      Node* input = edge->inputs_[in];
+      if (collapse_headers_ && edge->is_implicit(in) && !input->in_edge())
+        continue;
+      if (Visit(input, depth + 1)) {
+        drawn.inputs.push_back(input);
+        drawn.order_only.push_back(edge->is_order_only(in));
+      }
     }
+    edges_.push_back(drawn);
   }
+}
 
-  for (vector<Node*>::iterator in = edge->inputs_.begin();
-       in != edge->inputs_.end(); ++in) {
-    AddTarget(*in);
+void GraphViz::Finish() {
+  Walk();
+  switch (format_) {
+    case DOT: WriteDot(); break;
+    case JSON: WriteJSON(); break;
+    case GEXF: WriteGEXF(); break;
   }
+  fwrite(out_.data(), 1, out_.size(), out_file_);
+  out_.clear();
 }
 
-void GraphViz::Start() {
-  printf("digraph ninja {\n");
-  printf("rankdir=\"LR\"\n");
-  printf("node [fontsize=10, shape=box, height=0.25]\n");
-  printf("edge [fontsize=10]\n");
+void GraphViz::MaybeFlush() {
+  if (out_.size() >= (1 << 16)) {
+    fwrite(out_.data(), 1, out_.size(), out_file_);
+    out_.clear();
+  }
 }
 
-void GraphViz::Finish() {
-  printf("}\n");
+void GraphViz::WriteDot() {
+  char buf[256];
+  out_ += "digraph ninja {\n";
+  out_ += "rankdir=\"LR\"\n";
+  out_ += "node [fontsize=10, shape=box, height=0.25]\n";
+  out_ += "edge [fontsize=10]\n";
+
+  // Group the files by directory, keeping the order they were found in.
+  map<string, vector<Node*> > dirs;
+  for (vector<Node*>::iterator n = nodes_.begin(); n != nodes_.end(); ++n) {
+    string path = DisplayPath(*n);
+    size_t slash = cluster_dirs_ ? path.rfind('/') : string::npos;
+    dirs[slash == string::npos ? "" : path.substr(0, slash)].push_back(*n);
+  }
+  int cluster = 0;
+  for (map<string, vector<Node*> >::iterator dir = dirs.begin();
+       dir != dirs.end(); ++dir) {
+    bool in_cluster = !dir->first.empty();
+    if (in_cluster) {
+      snprintf(buf, sizeof(buf), "subgraph \"cluster_%d\" {\nlabel=\"",
+               cluster++);
+      out_ += buf;
+      out_ += DotEscape(dir->first) + "\"\n";
+    }
+    for (vector<Node*>::iterator n = dir->second.begin();
+         n != dir->second.end(); ++n) {
+      snprintf(buf, sizeof(buf), "\"%p\" [label=\"", *n);
+      out_ += buf;
+      out_ += DotEscape(DisplayPath(*n)) + "\"]\n";
+      MaybeFlush();
+    }
+    if (in_cluster)
+      out_ += "}\n";
+  }
+
+  for (vector<DrawnEdge>::iterator e = edges_.begin(); e != edges_.end();
+       ++e) {
+    const string& rule = e->edge->rule().name();
+    if (e->inputs.size() == 1 && e->outputs.size() == 1) {
+      // Can draw simply.
+      // Note extra space before label text -- this is cosmetic and feels
+      // like a graphviz bug.
+      snprintf(buf, sizeof(buf), "\"%p\" -> \"%p\" [label=\" ",
+               e->inputs[0], e->outputs[0]);
+      out_ += buf;
+      out_ += DotEscape(rule) + "\"]\n";
+    } else {
+      snprintf(buf, sizeof(buf), "\"%p\" [label=\"", e->edge);
+      out_ += buf;
+      out_ += DotEscape(rule) + "\", shape=ellipse]\n";
+      for (vector<Node*>::iterator out = e->outputs.begin();
+           out != e->outputs.end(); ++out) {
+        snprintf(buf, sizeof(buf), "\"%p\" -> \"%p\"\n", e->edge, *out);
+        out_ += buf;
+      }
+      for (size_t in = 0; in < e->inputs.size(); ++in) {
+        snprintf(buf, sizeof(buf), "\"%p\" -> \"%p\" [arrowhead=none%s]\n",
+                 e->inputs[in], e->edge,
+                 e->order_only[in] ? " style=dotted" : "");
+        out_ += buf;
+      }
+    }
+    MaybeFlush();
+  }
+  out_ += "}\n";
+}
+
+void GraphViz::WriteJSON() {
+  // Files and edges are both vertices, so that edges with several inputs
+  // and outputs don't turn into a product of links.
+  char buf[128];
+  out_ += "{\"nodes\": [";
+  for (size_t i = 0; i < nodes_.size(); ++i) {
+    snprintf(buf, sizeof(buf), "%s\n  {\"id\": %d, \"type\": \"file\", "
+             "\"label\": \"", i ? "," : "", (int)i);
+    out_ += buf;
+    EncodeJSONString(nodes_[i]->path(), &out_);
+    out_ += "\"}";
+    MaybeFlush();
+  }
+  for (size_t i = 0; i < edges_.size(); ++i) {
+    snprintf(buf, sizeof(buf), "%s\n  {\"id\": %d, \"type\": \"edge\", "
+             "\"label\": \"", nodes_.empty() && !i ? "" : ",",
+             (int)(nodes_.size() + i));
+    out_ += buf;
+    EncodeJSONString(edges_[i].edge->rule().name(), &out_);
+    out_ += "\"}";
+    MaybeFlush();
+  }
+  out_ += "\n],\n\"links\": [";
+  bool first = true;
+  for (size_t i = 0; i < edges_.size(); ++i) {
+    int edge_id = (int)(nodes_.size() + i);
+    const DrawnEdge& e = edges_[i];
+    for (size_t in = 0; in < e.inputs.size(); ++in) {
+      snprintf(buf, sizeof(buf), "%s\n  {\"source\": %d, \"target\": %d%s}",
+               first ? "" : ",", node_ids_[e.inputs[in]], edge_id,
+               e.order_only[in] ? ", \"order_only\": true" : "");
+      out_ += buf;
+      first = false;
+    }
+    for (size_t out = 0; out < e.outputs.size(); ++out) {
+      snprintf(buf, sizeof(buf), "%s\n  {\"source\": %d, \"target\": %d}",
+               first ? "" : ",", edge_id, node_ids_[e.outputs[out]]);
+      out_ += buf;
+      first = false;
+    }
+    MaybeFlush();
+  }
+  out_ += "\n]}\n";
+}
+
+void GraphViz::WriteGEXF() {
+  char buf[128];
+  out_ += "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+          "<gexf xmlns=\"http://www.gexf.net/1.2draft\" version=\"1.2\">\n"
+          "<graph defaultedgetype=\"directed\">\n"
+          "<nodes>\n";
+  for (size_t i = 0; i < nodes_.size(); ++i) {
+    snprintf(buf, sizeof(buf), "<node id=\"%d\" label=\"", (int)i);
+    out_ += buf;
+    out_ += XMLEscape(nodes_[i]->path()) + "\"/>\n";
+    MaybeFlush();
+  }
+  for (size_t i = 0; i < edges_.size(); ++i) {
+    snprintf(buf, sizeof(buf), "<node id=\"%d\" label=\"",
+             (int)(nodes_.size() + i));
+    out_ += buf;
+    out_ += XMLEscape(edges_[i].edge->rule().name()) + "\"/>\n";
+    MaybeFlush();
+  }
+  out_ += "</nodes>\n<edges>\n";
+  int link = 0;
+  for (size_t i = 0; i < edges_.size(); ++i) {
+    int edge_id = (int)(nodes_.size() + i);
+    const DrawnEdge& e = edges_[i];
+    for (size_t in = 0; in < e.inputs.size(); ++in) {
+      snprintf(buf, sizeof(buf),
+               "<edge id=\"%d\" source=\"%d\" target=\"%d\"/>\n",
+               link++, node_ids_[e.inputs[in]], edge_id);
+      out_ += buf;
+    }
+    for (size_t out = 0; out < e.outputs.size(); ++out) {
+      snprintf(buf, sizeof(buf),
+               "<edge id=\"%d\" source=\"%d\" target=\"%d\"/>\n",
+               link++, edge_id, node_ids_[e.outputs[out]]);
+      out_ += buf;
+    }
+    MaybeFlush();
+  }
+  out_ += "</edges>\n</graph>\n</gexf>\n";
 }
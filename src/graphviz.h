@@ -15,19 +15,84 @@
 #ifndef NINJA_GRAPHVIZ_H_
 #define NINJA_GRAPHVIZ_H_
 
+#include <stdio.h>
+
+#include <map>
 #include <set>
+#include <string>
+#include <vector>
 
+struct BuildLog;
 struct Node;
 struct Edge;
 
-/// Runs the process of creating GraphViz .dot file output.
+/// Runs the process of creating GraphViz .dot file output, or a graph in
+/// a format for large-graph viewers.
+///
+/// AddTarget() only records the targets; Finish() walks the graph from
+/// them breadth first, applying the filters, and writes it to out_file_.
 struct GraphViz {
-  void Start();
+  enum Format {
+    DOT,
+    JSON,
+    GEXF
+  };
+
+  GraphViz();
+
   void AddTarget(Node* node);
   void Finish();
 
-  std::set<Node*> visited_nodes_;
+  /// Output format.
+  Format format_;
+  /// Stop this many edges away from the targets; 0 means no limit.
+  int max_depth_;
+  /// Don't expand edges of these rules; their outputs are drawn as leaves.
+  std::set<std::string> skip_rules_;
+  /// Leave out files whose paths contain one of these strings.
+  std::vector<std::string> exclude_paths_;
+  /// Leave out implicit inputs that aren't built, which are usually
+  /// headers.
+  bool collapse_headers_;
+  /// Group files by directory (DOT only).
+  bool cluster_dirs_;
+  /// With a build log, don't expand edges whose last run took less than
+  /// this many milliseconds.
+  int min_cost_ms_;
+  BuildLog* build_log_;
+  /// Where to write the graph; stdout by default.
+  FILE* out_file_;
+
+ private:
+  /// A drawn edge with the inputs and outputs that passed the filters.
+  struct DrawnEdge {
+    Edge* edge;
+    std::vector<Node*> inputs;
+    std::vector<bool> order_only;
+    std::vector<Node*> outputs;
+  };
+
+  bool IsExcluded(Node* node) const;
+  bool ShouldExpand(Edge* edge, int depth) const;
+  /// Record \a node, to be expanded at \a depth.  @return false if it is
+  /// filtered out.
+  bool Visit(Node* node, int depth);
+  void Walk();
+
+  void WriteDot();
+  void WriteJSON();
+  void WriteGEXF();
+  /// Write out the buffered output if there is a lot of it.
+  void MaybeFlush();
+
+  std::vector<Node*> targets_;
+  /// Drawn files, in the order they were found, and their indices.
+  std::vector<Node*> nodes_;
+  std::map<Node*, int> node_ids_;
+  std::vector<std::pair<Node*, int> > queue_;
   std::set<Edge*> visited_edges_;
+  std::vector<DrawnEdge> edges_;
+  std::string out_;
 };
 
 #endif  // NINJA_GRAPHVIZ_H_
@@ -0,0 +1,182 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "graphviz.h"
+
+#include "build_log.h"
+#include "graph.h"
+#include "test.h"
+
+namespace {
+
+struct GraphVizTest : public StateTestWithBuiltinRules {
+  virtual void SetUp() {
+    ASSERT_NO_FATAL_FAILURE(AssertParse(&state_,
+"rule cc\n"
+"  command = cc $in\n"
+"build out: cat mid1 mid2\n"
+"build mid1: cat src/a.c | hdr.h || order\n"
+"build mid2: cc src/b.c\n"
+"build order: cat gen\n"));
+  }
+
+  /// Draw the graph of \a target and return the output.
+  string Draw(const string& target) {
+    FILE* f = tmpfile();
+    graph_.out_file_ = f;
+    graph_.AddTarget(state_.GetNode(target, 0));
+    graph_.Finish();
+    string output;
+    rewind(f);
+    char buf[4096];
+    size_t len;
+    while ((len = fread(buf, 1, sizeof(buf), f)) > 0)
+      output.append(buf, len);
+    fclose(f);
+    return output;
+  }
+
+  /// @return whether \a output has a file labelled \a path.
+  static bool HasFile(const string& output, const string& path) {
+    return output.find("[label=\"" + path + "\"]") != string::npos;
+  }
+
+  GraphViz graph_;
+};
+
+}  // namespace
+
+TEST_F(GraphVizTest, Dot) {
+  string output = Draw("out");
+  EXPECT_EQ(0u, output.find("digraph ninja {\n"));
+  EXPECT_TRUE(HasFile(output, "out"));
+  EXPECT_TRUE(HasFile(output, "src/a.c"));
+  EXPECT_TRUE(HasFile(output, "hdr.h"));
+  EXPECT_TRUE(HasFile(output, "gen"));
+  EXPECT_NE(string::npos, output.find("[label=\"cat\", shape=ellipse]"));
+  // Single input edges are drawn as an arrow.
+  EXPECT_NE(string::npos, output.find("[label=\" cc\"]"));
+  EXPECT_NE(string::npos, output.find("style=dotted"));
+  EXPECT_EQ(string::npos, output.find("subgraph"));
+}
+
+TEST_F(GraphVizTest, MaxDepth) {
+  graph_.max_depth_ = 1;
+  string output = Draw("out");
+  EXPECT_TRUE(HasFile(output, "mid1"));
+  EXPECT_TRUE(HasFile(output, "mid2"));
+  EXPECT_FALSE(HasFile(output, "src/a.c"));
+  EXPECT_FALSE(HasFile(output, "src/b.c"));
+}
+
+TEST_F(GraphVizTest, SkipRules) {
+  graph_.skip_rules_.insert("cc");
+  string output = Draw("out");
+  EXPECT_TRUE(HasFile(output, "mid2"));
+  EXPECT_FALSE(HasFile(output, "src/b.c"));
+  EXPECT_TRUE(HasFile(output, "src/a.c"));
+}
+
+TEST_F(GraphVizTest, ExcludePaths) {
+  graph_.exclude_paths_.push_back("src/");
+  string output = Draw("out");
+  EXPECT_FALSE(HasFile(output, "src/a.c"));
+  EXPECT_FALSE(HasFile(output, "src/b.c"));
+  EXPECT_TRUE(HasFile(output, "hdr.h"));
+}
+
+TEST_F(GraphVizTest, CollapseHeaders) {
+  graph_.collapse_headers_ = true;
+  string output = Draw("out");
+  EXPECT_FALSE(HasFile(output, "hdr.h"));
+  // Order-only and explicit inputs stay.
+  EXPECT_TRUE(HasFile(output, "order"));
+  EXPECT_TRUE(HasFile(output, "src/a.c"));
+}
+
+TEST_F(GraphVizTest, ClusterDirs) {
+  graph_.cluster_dirs_ = true;
+  string output = Draw("out");
+  EXPECT_NE(string::npos,
+            output.find("subgraph \"cluster_0\" {\nlabel=\"src\"\n"));
+}
+
+TEST_F(GraphVizTest, MinCost) {
+  BuildLog log;
+  log.RecordCommand(GetNode("mid1")->in_edge(), 0, 500);
+  log.RecordCommand(GetNode("mid2")->in_edge(), 0, 5);
+  graph_.build_log_ = &log;
+  graph_.min_cost_ms_ = 100;
+  string output = Draw("out");
+  EXPECT_TRUE(HasFile(output, "src/a.c"));
+  EXPECT_FALSE(HasFile(output, "src/b.c"));
+}
+
+TEST_F(GraphVizTest, MinCostAnyOutput) {
+  ASSERT_NO_FATAL_FAILURE(AssertParse(&state_,
+"build first second: cat in\n"));
+  // Only the second output is in the log.
+  State other;
+  AddCatRule(&other);
+  ASSERT_NO_FATAL_FAILURE(AssertParse(&other, "build second: cat in\n"));
+  BuildLog log;
+  log.RecordCommand(other.LookupNode("second")->in_edge(), 0, 5);
+  graph_.build_log_ = &log;
+  graph_.min_cost_ms_ = 100;
+  string output = Draw("first");
+  EXPECT_TRUE(HasFile(output, "first"));
+  EXPECT_FALSE(HasFile(output, "in"));
+}
+
+TEST_F(GraphVizTest, DotEscaping) {
+  ASSERT_NO_FATAL_FAILURE(AssertParse(&state_,
+"build di\"r/quo\"te: cat in\n"));
+  graph_.cluster_dirs_ = true;
+  string output = Draw("di\"r/quo\"te");
+  EXPECT_TRUE(HasFile(output, "di\\\"r/quo\\\"te"));
+  EXPECT_NE(string::npos, output.find("label=\"di\\\"r\"\n"));
+}
+
+TEST_F(GraphVizTest, JSON) {
+  graph_.format_ = GraphViz::JSON;
+  graph_.max_depth_ = 1;
+  string output = Draw("out");
+  EXPECT_EQ(
+"{\"nodes\": [\n"
+"  {\"id\": 0, \"type\": \"file\", \"label\": \"out\"},\n"
+"  {\"id\": 1, \"type\": \"file\", \"label\": \"mid1\"},\n"
+"  {\"id\": 2, \"type\": \"file\", \"label\": \"mid2\"},\n"
+"  {\"id\": 3, \"type\": \"edge\", \"label\": \"cat\"}\n"
+"],\n"
+"\"links\": [\n"
+"  {\"source\": 1, \"target\": 3},\n"
+"  {\"source\": 2, \"target\": 3},\n"
+"  {\"source\": 3, \"target\": 0}\n"
+"]}\n", output);
+}
+
+TEST_F(GraphVizTest, GEXF) {
+  ASSERT_NO_FATAL_FAILURE(AssertParse(&state_,
+"build a\"b: cat in\n"));
+  graph_.format_ = GraphViz::GEXF;
+  string output = Draw("a\"b");
+  EXPECT_NE(string::npos,
+            output.find("<node id=\"0\" label=\"a&quot;b\"/>\n"
+                        "<node id=\"1\" label=\"in\"/>\n"
+                        "<node id=\"2\" label=\"cat\"/>\n"));
+  EXPECT_NE(string::npos,
+            output.find("<edge id=\"0\" source=\"1\" target=\"2\"/>\n"
+                        "<edge id=\"1\" source=\"2\" target=\"0\"/>\n"));
+  EXPECT_NE(string::npos, output.find("</gexf>\n"));
+}
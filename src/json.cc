@@ -0,0 +1,64 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "json.h"
+
+#include "graph.h"
+
+void EncodeJSONString(const string& in, string* out) {
+  static const char kHexDigits[] = "0123456789abcdef";
+  const char* start = in.data();
+  const char* end = start + in.size();
+  const char* run = start;
+  for (const char* p = start; p != end; ++p) {
+    unsigned char c = *p;
+    if (c >= 0x20 && c != '"' && c != '\\')
+      continue;
+    out->append(run, p - run);
+    run = p + 1;
+    switch (c) {
+      case '"': out->append("\\\""); break;
+      case '\\': out->append("\\\\"); break;
+      case '\b': out->append("\\b"); break;
+      case '\f': out->append("\\f"); break;
+      case '\n': out->append("\\n"); break;
+      case '\r': out->append("\\r"); break;
+      case '\t': out->append("\\t"); break;
+      default: {
+        char buf[7] = { '\\', 'u', '0', '0',
+                        kHexDigits[c >> 4], kHexDigits[c & 0xf], '\0' };
+        out->append(buf, 6);
+        break;
+      }
+    }
+  }
+  out->append(run, end - run);
+}
+
+void AppendJSONPath(const string& path, string* out) {
+  *out += '"';
+  EncodeJSONString(path, out);
+  *out += '"';
+}
+
+void AppendJSONPaths(const vector<Node*>& nodes, string* out) {
+  *out += '[';
+  for (vector<Node*>::const_iterator n = nodes.begin(); n != nodes.end();
+       ++n) {
+    if (n != nodes.begin())
+      *out += ", ";
+    AppendJSONPath((*n)->path(), out);
+  }
+  *out += ']';
+}
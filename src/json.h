@@ -0,0 +1,35 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NINJA_JSON_H_
+#define NINJA_JSON_H_
+
+#include <string>
+#include <vector>
+using namespace std;
+
+struct Node;
+
+/// Append |in| to |out| as the contents of a JSON string literal (without the
+/// surrounding quotes).  Runs of characters that need no escaping are copied
+/// in one go.
+void EncodeJSONString(const string& in, string* out);
+
+/// Append \a path to \a out as a JSON string.
+void AppendJSONPath(const string& path, string* out);
+
+/// Append the paths of \a nodes to \a out as a JSON array.
+void AppendJSONPaths(const vector<Node*>& nodes, string* out);
+
+#endif  // NINJA_JSON_H_
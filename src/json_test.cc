@@ -0,0 +1,62 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "json.h"
+
+#include "graph.h"
+#include "test.h"
+
+namespace {
+
+string Encode(const string& in) {
+  string out;
+  EncodeJSONString(in, &out);
+  return out;
+}
+
+}  // namespace
+
+TEST(JSONTest, Plain) {
+  EXPECT_EQ("", Encode(""));
+  EXPECT_EQ("cc -c foo.c -o foo.o", Encode("cc -c foo.c -o foo.o"));
+}
+
+TEST(JSONTest, Escapes) {
+  EXPECT_EQ("a\\\"b\\\\c", Encode("a\"b\\c"));
+  EXPECT_EQ("\\n\\t\\r", Encode("\n\t\r"));
+  EXPECT_EQ("x\\u0001y\\u001f", Encode(string("x\1y\x1f")));
+  // Non-ASCII bytes are passed through unchanged.
+  EXPECT_EQ("caf\xc3\xa9", Encode("caf\xc3\xa9"));
+}
+
+TEST(JSONTest, Append) {
+  string out = "\"";
+  EncodeJSONString("a\"", &out);
+  EXPECT_EQ("\"a\\\"", out);
+}
+
+TEST(JSONTest, Paths) {
+  Node a("a\"b", 0);
+  Node c("c", 0);
+  vector<Node*> nodes;
+  string out;
+  AppendJSONPaths(nodes, &out);
+  EXPECT_EQ("[]", out);
+
+  nodes.push_back(&a);
+  nodes.push_back(&c);
+  out.clear();
+  AppendJSONPaths(nodes, &out);
+  EXPECT_EQ("[\"a\\\"b\", \"c\"]", out);
+}
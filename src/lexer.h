@@ -89,6 +89,11 @@ struct Lexer {
   /// Construct an error message with context.
   bool Error(const string& message, string* err);
 
+  /// Return the first character in [p, end) that ends a run of plain text
+  /// in a $-escaped string, i.e. one of "$ :|\r\n" or NUL, or |end| if
+  /// there is none.  Public for testing.
+  static const char* SkipPlainText(const char* p, const char* end);
+
 private:
   /// Skip past whitespace (called after each read token/ident/etc.).
   void EatWhitespace();
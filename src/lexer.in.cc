@@ -16,6 +16,15 @@
 
 #include <stdio.h>
 
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NINJA_LEXER_SSE2
+#include <emmintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
 #include "eval_env.h"
 #include "util.h"
 
@@ -202,11 +211,67 @@ bool Lexer::ReadIdent(string* out) {
   return true;
 }
 
+// static
+const char* Lexer::SkipPlainText(const char* p, const char* end) {
+#ifdef NINJA_LEXER_SSE2
+  const __m128i nul = _mm_setzero_si128();
+  const __m128i newline = _mm_set1_epi8('\n');
+  const __m128i carriage_return = _mm_set1_epi8('\r');
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i dollar = _mm_set1_epi8('$');
+  const __m128i colon = _mm_set1_epi8(':');
+  const __m128i pipe = _mm_set1_epi8('|');
+  while (end - p >= 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i special = _mm_or_si128(
+        _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, nul),
+                                  _mm_cmpeq_epi8(chunk, newline)),
+                     _mm_or_si128(_mm_cmpeq_epi8(chunk, carriage_return),
+                                  _mm_cmpeq_epi8(chunk, space))),
+        _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, dollar),
+                                  _mm_cmpeq_epi8(chunk, colon)),
+                     _mm_cmpeq_epi8(chunk, pipe)));
+    unsigned int mask = _mm_movemask_epi8(special);
+    if (mask) {
+#ifdef _MSC_VER
+      unsigned long index;
+      _BitScanForward(&index, mask);
+      return p + index;
+#else
+      return p + __builtin_ctz(mask);
+#endif
+    }
+    p += 16;
+  }
+#endif
+  for (; p < end; ++p) {
+    switch (*p) {
+    case '\0':
+    case '\n':
+    case '\r':
+    case ' ':
+    case '$':
+    case ':':
+    case '|':
+      return p;
+    }
+  }
+  return p;
+}
+
 bool Lexer::ReadEvalString(EvalString* eval, bool path, string* err) {
   const char* p = ofs_;
   const char* q;
   const char* start;
+  const char* end = input_.str_ + input_.len_;
   for (;;) {
+    // Runs of plain text make up most of a manifest; skip them without
+    // going through the state machine below.
+    const char* plain_end = SkipPlainText(p, end);
+    if (plain_end != p) {
+      eval->AddText(StringPiece(p, plain_end - p));
+      p = plain_end;
+    }
     start = p;
     /*!re2c
     [^$ :\r\n|\000]+ {
@@ -94,3 +94,95 @@ TEST(Lexer, Tabs) {
   EXPECT_EQ(Lexer::ERROR, token);
   EXPECT_EQ("tabs are not allowed, use spaces", lexer.DescribeLastError());
 }
+
+namespace {
+
+/// A small deterministic generator for the randomized tests below.
+struct TestRandom {
+  explicit TestRandom(unsigned int seed) : state_(seed) {}
+  unsigned int Next(unsigned int n) {
+    state_ = state_ * 1103515245 + 12345;
+    return (state_ >> 16) % n;
+  }
+  unsigned int state_;
+};
+
+}  // namespace
+
+TEST(Lexer, SkipPlainTextMatchesReference) {
+  // Compare the (possibly vectorized) scanner against a byte-by-byte
+  // reference at every alignment and length, with stop characters placed
+  // at every position within and around a 16-byte stride.
+  const char kAlphabet[] = "ab/._-=$ :|\r\n";
+  TestRandom random(1);
+  char buf[80];
+  for (int iteration = 0; iteration < 2000; ++iteration) {
+    for (size_t i = 0; i < sizeof(buf); ++i) {
+      // Mostly plain characters, so that long runs are common.
+      buf[i] = random.Next(8) ? kAlphabet[random.Next(5)]
+                              : kAlphabet[random.Next(sizeof(kAlphabet))];
+    }
+    size_t begin = random.Next(20);
+    size_t end = begin + random.Next(sizeof(buf) - begin + 1);
+    const char* expected = buf + begin;
+    while (expected < buf + end && !strchr("$ :|\r\n", *expected))
+      ++expected;
+    ASSERT_EQ(expected - buf,
+              Lexer::SkipPlainText(buf + begin, buf + end) - buf);
+  }
+}
+
+TEST(Lexer, ReadVarValueRandomized) {
+  // Lex randomly generated values and compare against the tokens they
+  // were generated from, exercising plain runs of every length.
+  TestRandom random(2);
+  for (int iteration = 0; iteration < 500; ++iteration) {
+    string input, raw, expected;
+    int pieces = random.Next(12);
+    for (int i = 0; i < pieces; ++i) {
+      switch (random.Next(6)) {
+      case 0: {
+        size_t len = random.Next(40) + 1;
+        for (size_t j = 0; j < len; ++j)
+          input.push_back("abc/._-="[random.Next(8)]);
+        raw.append(input, input.size() - len, len);
+        break;
+      }
+      case 1:
+        input.push_back(" :|"[random.Next(3)]);
+        raw.push_back(input[input.size() - 1]);
+        break;
+      case 2:
+        input.append("$$");
+        raw.append("$");
+        break;
+      case 3:
+        input.append("$ ");
+        raw.append(" ");
+        break;
+      case 4:
+        input.append("$:");
+        raw.append(":");
+        break;
+      case 5:
+        if (!raw.empty())
+          expected.append("[" + raw + "]");
+        raw.clear();
+        input.append("${var}");
+        expected.append("[$var]");
+        break;
+      }
+    }
+    if (!raw.empty())
+      expected.append("[" + raw + "]");
+    input.append("\n");
+
+    Lexer lexer(input.c_str());
+    EvalString eval;
+    string err;
+    ASSERT_TRUE(lexer.ReadVarValue(&eval, &err));
+    EXPECT_EQ("", err);
+    EXPECT_EQ(expected, eval.Serialize());
+    EXPECT_EQ(Lexer::TEOF, lexer.ReadToken());
+  }
+}
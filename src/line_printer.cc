@@ -27,7 +27,8 @@
 
 #include "util.h"
 
-LinePrinter::LinePrinter() : have_blank_line_(true), console_locked_(false) {
+LinePrinter::LinePrinter()
+    : have_blank_line_(true), console_locked_(false), spill_file_(NULL) {
 #ifndef _WIN32
   const char* term = getenv("TERM");
   smart_terminal_ = isatty(1) && term && string(term) != "dumb";
@@ -50,14 +51,12 @@ void LinePrinter::Print(string to_print, LineType type) {
     return;
   }
 
-  if (smart_terminal_) {
+  if (smart_terminal_ && type == ELIDE) {
+#ifdef _WIN32
     printf("\r");  // Print over previous line, if any.
     // On Windows, calling a C library function writing to stdout also handles
     // pausing the executable when the "Pause" key or Ctrl-S is pressed.
-  }
 
-  if (smart_terminal_ && type == ELIDE) {
-#ifdef _WIN32
     CONSOLE_SCREEN_BUFFER_INFO csbi;
     GetConsoleScreenBufferInfo(console_, &csbi);
 
@@ -85,20 +84,71 @@ void LinePrinter::Print(string to_print, LineType type) {
     if ((ioctl(0, TIOCGWINSZ, &size) == 0) && size.ws_col) {
       to_print = ElideMiddle(to_print, size.ws_col);
     }
-    printf("%s", to_print.c_str());
-    printf("\x1B[K");  // Clear to end of line.
+    // Write the whole line at once, so the terminal never shows it half
+    // drawn.
+    to_print.insert(0, "\r");  // Print over previous line, if any.
+    to_print += "\x1B[K";  // Clear to end of line.
+    fwrite(to_print.data(), 1, to_print.size(), stdout);
     fflush(stdout);
 #endif
 
     have_blank_line_ = false;
   } else {
-    printf("%s\n", to_print.c_str());
+    if (smart_terminal_)
+      to_print.insert(0, "\r");  // Print over previous line, if any.
+    to_print += '\n';
+    fwrite(to_print.data(), 1, to_print.size(), stdout);
   }
 }
 
+void LinePrinter::Buffer(const char* data, size_t size) {
+  output_buffer_.append(data, size);
+  if (output_buffer_.size() < kMaxBufferedOutput)
+    return;
+  // A console edge can run for a long time and print a lot; keep the
+  // output in a temporary file rather than in memory.  If that can't be
+  // created, keep buffering in memory.
+  if (!spill_file_)
+    spill_file_ = tmpfile();
+  if (spill_file_ &&
+      fwrite(output_buffer_.data(), 1, output_buffer_.size(), spill_file_) ==
+          output_buffer_.size()) {
+    output_buffer_.clear();
+  }
+}
+
+void LinePrinter::FlushBuffer() {
+  if (!spill_file_) {
+    PrintOnNewLine(output_buffer_);
+    output_buffer_.clear();
+    return;
+  }
+
+  // Same as PrintOnNewLine() with the spilled output in front of
+  // |output_buffer_|: print it all verbatim, on a new line.
+  if (!have_blank_line_)
+    fwrite("\n", 1, 1, stdout);
+  rewind(spill_file_);
+  char buf[64 << 10];
+  size_t len;
+  char last = '\n';
+  while ((len = fread(buf, 1, sizeof(buf), spill_file_)) > 0) {
+    fwrite(buf, 1, len, stdout);
+    last = buf[len - 1];
+  }
+  fclose(spill_file_);
+  spill_file_ = NULL;
+  if (!output_buffer_.empty()) {
+    fwrite(output_buffer_.data(), 1, output_buffer_.size(), stdout);
+    last = output_buffer_[output_buffer_.size() - 1];
+  }
+  have_blank_line_ = last == '\n';
+  output_buffer_.clear();
+}
+
 void LinePrinter::PrintOrBuffer(const char* data, size_t size) {
   if (console_locked_) {
-    output_buffer_.append(data, size);
+    Buffer(data, size);
   } else {
     // Avoid printf and C strings, since the actual output might contain null
     // bytes like UTF-16 does (yuck).
@@ -108,8 +158,8 @@ void LinePrinter::PrintOrBuffer(const char* data, size_t size) {
 
 void LinePrinter::PrintOnNewLine(const string& to_print) {
   if (console_locked_ && !line_buffer_.empty()) {
-    output_buffer_.append(line_buffer_);
-    output_buffer_.append(1, '\n');
+    line_buffer_.append(1, '\n');
+    Buffer(line_buffer_.data(), line_buffer_.size());
     line_buffer_.clear();
   }
   if (!have_blank_line_) {
@@ -131,11 +181,10 @@ void LinePrinter::SetConsoleLocked(bool locked) {
   console_locked_ = locked;
 
   if (!locked) {
-    PrintOnNewLine(output_buffer_);
+    FlushBuffer();
     if (!line_buffer_.empty()) {
       Print(line_buffer_, line_type_);
     }
-    output_buffer_.clear();
     line_buffer_.clear();
   }
 }
@@ -16,6 +16,7 @@
 #define NINJA_LINE_PRINTER_H_
 
 #include <stddef.h>
+#include <stdio.h>
 #include <string>
 using namespace std;
 
@@ -61,12 +62,24 @@ struct LinePrinter {
   /// Buffered console output while console is locked.
   string output_buffer_;
 
+  /// Console output that didn't fit in |output_buffer_|, or NULL.
+  FILE* spill_file_;
+
+  /// How much console output to keep in memory while the console is locked.
+  static const size_t kMaxBufferedOutput = 1 << 20;
+
 #ifdef _WIN32
   void* console_;
 #endif
 
   /// Print the given data to the console, or buffer it if it is locked.
   void PrintOrBuffer(const char *data, size_t size);
+
+  /// Append to the console output buffered while the console is locked.
+  void Buffer(const char* data, size_t size);
+
+  /// Print the console output buffered while the console was locked.
+  void FlushBuffer();
 };
 
 #endif  // NINJA_LINE_PRINTER_H_
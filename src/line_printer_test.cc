@@ -0,0 +1,65 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "line_printer.h"
+
+#include "test.h"
+
+#ifndef _WIN32
+
+// Failures are reported on stdout, so the tests only check the captured
+// output once the capture has ended.
+
+TEST(LinePrinterTest, BufferWhileLocked) {
+  string locked, unlocked;
+  {
+    ScopedStdoutCapture capture;
+    LinePrinter printer;
+    printer.set_smart_terminal(false);
+
+    printer.SetConsoleLocked(true);
+    printer.PrintOnNewLine("a");
+    printer.PrintOnNewLine("b\n");
+    printer.Print("status", LinePrinter::FULL);
+    locked = capture.Read();
+    printer.SetConsoleLocked(false);
+    unlocked = capture.Read();
+  }
+  EXPECT_EQ("", locked);
+  EXPECT_EQ("a\nb\nstatus\n", unlocked);
+}
+
+TEST(LinePrinterTest, SpillWhileLocked) {
+  // More than is kept in memory, spilled to a file without a trailing
+  // newline, followed by output that stays in memory.
+  string big(3 << 19, 'x');
+  string locked, unlocked;
+  {
+    ScopedStdoutCapture capture;
+    LinePrinter printer;
+    printer.set_smart_terminal(false);
+
+    printer.SetConsoleLocked(true);
+    printer.PrintOnNewLine(big);
+    printer.PrintOnNewLine("tail\n");
+    locked = capture.Read();
+    printer.SetConsoleLocked(false);
+    unlocked = capture.Read();
+  }
+  EXPECT_EQ("", locked);
+  // The spilled output and the rest are joined as they were printed.
+  EXPECT_TRUE(big + "\ntail\n" == unlocked);
+}
+
+#endif  // _WIN32
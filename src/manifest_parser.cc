@@ -330,7 +330,11 @@ bool ManifestParser::ParseEdge(string* err) {
   Edge* edge = state_->AddEdge(rule);
   edge->env_ = env;
 
-  string pool_name = edge->GetBinding("pool");
+  // Most rules don't set a pool, in which case the edge's pool can only
+  // come from its own scope chain; look it up there directly instead of
+  // going through a full edge evaluation.
+  string pool_name = rule->GetBinding("pool") ? edge->GetBinding("pool")
+                                              : env->LookupVariable("pool");
   if (!pool_name.empty()) {
     Pool* pool = state_->LookupPool(pool_name);
     if (pool == NULL)
@@ -402,9 +406,9 @@ bool ManifestParser::ParseEdge(string* err) {
     }
   }
 
-  // Multiple outputs aren't (yet?) supported with depslog.
-  string deps_type = edge->GetBinding("deps");
-  if (!deps_type.empty() && edge->outputs_.size() > 1) {
+  // Multiple outputs aren't (yet?) supported with depslog.  Only evaluate
+  // the deps binding when it could matter.
+  if (edge->outputs_.size() > 1 && !edge->GetBinding("deps").empty()) {
     return lexer_.Error("multiple outputs aren't (yet?) supported by depslog; "
                         "bring this up on the mailing list if it affects you",
                         err);
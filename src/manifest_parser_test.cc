@@ -836,6 +836,28 @@ TEST_F(ParserTest, Errors) {
   }
 }
 
+TEST_F(ParserTest, PoolBindings) {
+  ASSERT_NO_FATAL_FAILURE(AssertParse(
+"pool p1\n"
+"  depth = 1\n"
+"pool p2\n"
+"  depth = 2\n"
+"rule from_rule\n"
+"  command = cmd\n"
+"  pool = $edge_pool\n"
+"rule plain\n"
+"  command = cmd\n"
+"build a: from_rule\n"
+"  edge_pool = p1\n"
+"build b: plain\n"
+"  pool = p2\n"
+"build c: plain\n"));
+
+  EXPECT_EQ("p1", state.LookupNode("a")->in_edge()->pool()->name());
+  EXPECT_EQ("p2", state.LookupNode("b")->in_edge()->pool()->name());
+  EXPECT_EQ(&State::kDefaultPool, state.LookupNode("c")->in_edge()->pool());
+}
+
 TEST_F(ParserTest, MissingInput) {
   State local_state;
   ManifestParser parser(&local_state, &fs_);
@@ -12,6 +12,12 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#ifndef _WIN32
+#ifndef __STDC_FORMAT_MACROS
+#define __STDC_FORMAT_MACROS
+#endif
+#endif
+
 #include "metrics.h"
 
 #include <errno.h>
@@ -19,6 +25,8 @@
 #include <string.h>
 
 #ifndef _WIN32
+#include <inttypes.h>
+#include <sys/resource.h>
 #include <sys/time.h>
 #else
 #include <windows.h>
@@ -26,6 +34,7 @@
 
 #include <algorithm>
 
+#include "json.h"
 #include "util.h"
 
 Metrics* g_metrics = NULL;
@@ -72,49 +81,246 @@ int64_t TimerToMicros(int64_t dt) {
 }
 #endif
 
+/// The innermost ScopedMetric that is currently recording.
+ScopedMetric* g_current_scope = NULL;
+
+/// Returns the nesting depth of |metric| in the report.
+int Depth(const Metric* metric) {
+  int depth = 0;
+  for (metric = metric->parent; metric; metric = metric->parent)
+    ++depth;
+  return depth;
+}
+
+/// Returns |metrics| in depth-first order of the parent relation, with
+/// siblings in the order they were created.
+vector<Metric*> TreeOrder(const vector<Metric*>& metrics) {
+  vector<Metric*> order;
+  vector<Metric*> stack;
+  for (vector<Metric*>::const_reverse_iterator i = metrics.rbegin();
+       i != metrics.rend(); ++i) {
+    if (!(*i)->parent)
+      stack.push_back(*i);
+  }
+  while (!stack.empty()) {
+    Metric* metric = stack.back();
+    stack.pop_back();
+    order.push_back(metric);
+    for (vector<Metric*>::const_reverse_iterator i = metrics.rbegin();
+         i != metrics.rend(); ++i) {
+      if ((*i)->parent == metric)
+        stack.push_back(*i);
+    }
+  }
+  return order;
+}
+
+/// Appends OS-level counters for this process to |counters|.
+void GetProcessCounters(vector<pair<const char*, int64_t> >* counters) {
+#ifndef _WIN32
+  rusage usage;
+  if (getrusage(RUSAGE_SELF, &usage) == 0) {
+    counters->push_back(make_pair("minor page faults",
+                                  (int64_t)usage.ru_minflt));
+    counters->push_back(make_pair("major page faults",
+                                  (int64_t)usage.ru_majflt));
+    counters->push_back(make_pair("voluntary context switches",
+                                  (int64_t)usage.ru_nvcsw));
+    counters->push_back(make_pair("involuntary context switches",
+                                  (int64_t)usage.ru_nivcsw));
+    counters->push_back(make_pair("blocks read", (int64_t)usage.ru_inblock));
+    counters->push_back(make_pair("blocks written",
+                                  (int64_t)usage.ru_oublock));
+  }
+#ifdef __linux__
+  // Unlike the block counts, these include reads served by the page cache.
+  if (FILE* f = fopen("/proc/self/io", "r")) {
+    char line[256];
+    long long value;
+    while (fgets(line, sizeof(line), f)) {
+      if (sscanf(line, "rchar: %lld", &value) == 1)
+        counters->push_back(make_pair("bytes read", (int64_t)value));
+      else if (sscanf(line, "wchar: %lld", &value) == 1)
+        counters->push_back(make_pair("bytes written", (int64_t)value));
+    }
+    fclose(f);
+  }
+#endif
+#else
+  IO_COUNTERS io;
+  if (GetProcessIoCounters(GetCurrentProcess(), &io)) {
+    counters->push_back(make_pair("read operations",
+                                  (int64_t)io.ReadOperationCount));
+    counters->push_back(make_pair("bytes read",
+                                  (int64_t)io.ReadTransferCount));
+    counters->push_back(make_pair("write operations",
+                                  (int64_t)io.WriteOperationCount));
+    counters->push_back(make_pair("bytes written",
+                                  (int64_t)io.WriteTransferCount));
+  }
+#endif
+}
+
+/// Prints |str| as a JSON string.
+void PrintJSONString(const string& str) {
+  string encoded;
+  EncodeJSONString(str, &encoded);
+  printf("\"%s\"", encoded.c_str());
+}
+
 }  // anonymous namespace
 
+Metric::Metric(const string& name)
+    : name(name), count(0), sum(0), self_sum(0), max(0), parent(NULL) {
+  memset(histogram, 0, sizeof(histogram));
+}
+
+void Metric::Record(int64_t micros, int64_t self_micros) {
+  ++count;
+  sum += micros;
+  self_sum += self_micros;
+  if (micros > max)
+    max = micros;
+  ++histogram[BucketFor(micros)];
+}
+
+// static
+int Metric::BucketFor(int64_t micros) {
+  if (micros < 8)
+    return micros < 0 ? 0 : (int)micros;
+  int log2 = 3;
+  while (log2 < 62 && (micros >> (log2 + 1)))
+    ++log2;
+  // The two bits below the leading one pick one of four buckets.
+  int quarter = (int)((micros >> (log2 - 2)) & 3);
+  return 8 + (log2 - 3) * 4 + quarter;
+}
+
+// static
+int64_t Metric::BucketStart(int bucket) {
+  if (bucket < 8)
+    return bucket;
+  int log2 = (bucket - 8) / 4 + 3;
+  int64_t quarter = (bucket - 8) % 4;
+  return (4 + quarter) << (log2 - 2);
+}
+
+int64_t Metric::Percentile(double fraction) const {
+  int64_t rank = (int64_t)(fraction * count + 0.5);
+  if (rank < 1)
+    rank = 1;
+  int64_t seen = 0;
+  for (int bucket = 0; bucket < kBuckets; ++bucket) {
+    seen += histogram[bucket];
+    if (seen >= rank) {
+      // Report the end of the bucket, but never more than the maximum.
+      int64_t end = bucket + 1 < kBuckets ? BucketStart(bucket + 1) - 1 : max;
+      return min(end, max);
+    }
+  }
+  return max;
+}
 
 ScopedMetric::ScopedMetric(Metric* metric) {
   metric_ = metric;
   if (!metric_)
     return;
+  parent_ = g_current_scope;
+  children_ = 0;
+  g_current_scope = this;
+
+  // Attribute the metric to the first one it's recorded inside of, unless
+  // that would make the tree of metrics cyclic.
+  if (parent_ && !metric_->parent) {
+    Metric* ancestor = parent_->metric_;
+    while (ancestor && ancestor != metric_)
+      ancestor = ancestor->parent;
+    if (!ancestor)
+      metric_->parent = parent_->metric_;
+  }
+
   start_ = HighResTimer();
 }
 ScopedMetric::~ScopedMetric() {
   if (!metric_)
     return;
-  metric_->count++;
   int64_t dt = TimerToMicros(HighResTimer() - start_);
-  metric_->sum += dt;
+  metric_->Record(dt, dt - children_);
+  if (parent_)
+    parent_->children_ += dt;
+  g_current_scope = parent_;
 }
 
 Metric* Metrics::NewMetric(const string& name) {
-  Metric* metric = new Metric;
-  metric->name = name;
-  metric->count = 0;
-  metric->sum = 0;
+  Metric* metric = new Metric(name);
   metrics_.push_back(metric);
   return metric;
 }
 
 void Metrics::Report() {
+  vector<Metric*> order = TreeOrder(metrics_);
+  vector<pair<const char*, int64_t> > counters;
+  GetProcessCounters(&counters);
+
   int width = 0;
-  for (vector<Metric*>::iterator i = metrics_.begin();
-       i != metrics_.end(); ++i) {
-    width = max((int)(*i)->name.size(), width);
-  }
+  for (vector<Metric*>::iterator i = order.begin(); i != order.end(); ++i)
+    width = max(2 * Depth(*i) + (int)(*i)->name.size(), width);
+  for (size_t i = 0; i < counters.size(); ++i)
+    width = max((int)strlen(counters[i].first), width);
 
-  printf("%-*s\t%-6s\t%-9s\t%s\n", width,
-         "metric", "count", "avg (us)", "total (ms)");
-  for (vector<Metric*>::iterator i = metrics_.begin();
-       i != metrics_.end(); ++i) {
+  printf("%-*s\t%-6s\t%-9s\t%-9s\t%-9s\t%-9s\t%-9s\t%-10s\t%s\n", width,
+         "metric", "count", "avg (us)", "p50 (us)", "p90 (us)", "p99 (us)",
+         "max (us)", "total (ms)", "self (ms)");
+  for (vector<Metric*>::iterator i = order.begin(); i != order.end(); ++i) {
     Metric* metric = *i;
+    int indent = 2 * Depth(metric);
     double total = metric->sum / (double)1000;
+    double self = metric->self_sum / (double)1000;
     double avg = metric->sum / (double)metric->count;
-    printf("%-*s\t%-6d\t%-8.1f\t%.1f\n", width, metric->name.c_str(),
-           metric->count, avg, total);
+    printf("%*s%-*s\t%-6d\t%-8.1f\t%-9" PRId64 "\t%-9" PRId64 "\t%-9" PRId64
+           "\t%-9" PRId64 "\t%-10.1f\t%.1f\n",
+           indent, "", width - indent, metric->name.c_str(), metric->count, avg,
+           metric->Percentile(0.5), metric->Percentile(0.9),
+           metric->Percentile(0.99), metric->max, total, self);
+  }
+
+  if (!counters.empty())
+    printf("\n");
+  for (size_t i = 0; i < counters.size(); ++i)
+    printf("%-*s\t%" PRId64 "\n", width, counters[i].first, counters[i].second);
+}
+
+void Metrics::ReportJSON() {
+  printf("{\"metrics\":[");
+  vector<Metric*> order = TreeOrder(metrics_);
+  for (vector<Metric*>::iterator i = order.begin(); i != order.end(); ++i) {
+    Metric* metric = *i;
+    if (i != order.begin())
+      printf(",");
+    printf("{\"name\":");
+    PrintJSONString(metric->name);
+    printf(",\"parent\":");
+    if (metric->parent)
+      PrintJSONString(metric->parent->name);
+    else
+      printf("null");
+    printf(",\"count\":%d,\"total_us\":%" PRId64 ",\"self_us\":%" PRId64
+           ",\"p50_us\":%" PRId64 ",\"p90_us\":%" PRId64
+           ",\"p99_us\":%" PRId64 ",\"max_us\":%" PRId64 "}",
+           metric->count, metric->sum, metric->self_sum,
+           metric->Percentile(0.5), metric->Percentile(0.9),
+           metric->Percentile(0.99), metric->max);
+  }
+  printf("],\"counters\":{");
+  vector<pair<const char*, int64_t> > counters;
+  GetProcessCounters(&counters);
+  for (size_t i = 0; i < counters.size(); ++i) {
+    if (i)
+      printf(",");
+    PrintJSONString(counters[i].first);
+    printf(":%" PRId64, counters[i].second);
   }
+  printf("}}\n");
 }
 
 uint64_t Stopwatch::Now() const {
@@ -26,16 +26,41 @@ using namespace std;
 
 /// A single metrics we're tracking, like "depfile load time".
 struct Metric {
+  explicit Metric(const string& name);
+
+  /// Account for one run of the code path that took |micros|, |self_micros|
+  /// of which were spent outside of nested metrics.
+  void Record(int64_t micros, int64_t self_micros);
+
+  /// Returns the approximate time (in micros) that |fraction| of the runs
+  /// took at most.
+  int64_t Percentile(double fraction) const;
+
   string name;
   /// Number of times we've hit the code path.
   int count;
   /// Total time (in micros) we've spent on the code path.
   int64_t sum;
+  /// Part of |sum| not spent in metrics nested in this one.
+  int64_t self_sum;
+  /// Longest time (in micros) a single run took.
+  int64_t max;
+  /// The metric this one was first recorded inside of, or NULL.
+  Metric* parent;
+
+  /// Run counts by duration.  Durations below 8us get a bucket each, longer
+  /// ones four buckets per power of two, so percentiles are within 25%.
+  enum { kBuckets = 8 + 4 * 60 };
+  static int BucketFor(int64_t micros);
+  static int64_t BucketStart(int bucket);
+  int histogram[kBuckets];
 };
 
 
 /// A scoped object for recording a metric across the body of a function.
-/// Used by the METRIC_RECORD macro.
+/// Used by the METRIC_RECORD macro.  Scopes nest, so that the time spent in
+/// a metric can be attributed to the metric it was recorded inside of.
+/// Like the rest of the metrics, this assumes it's used on one thread only.
 struct ScopedMetric {
   explicit ScopedMetric(Metric* metric);
   ~ScopedMetric();
@@ -45,6 +70,10 @@ private:
   /// Timestamp when the measurement started.
   /// Value is platform-dependent.
   int64_t start_;
+  /// The scope this one is nested in, or NULL.
+  ScopedMetric* parent_;
+  /// Time (in micros) spent in scopes nested in this one.
+  int64_t children_;
 };
 
 /// The singleton that stores metrics and prints the report.
@@ -54,6 +83,9 @@ struct Metrics {
   /// Print a summary report to stdout.
   void Report();
 
+  /// Print the same information as a single line of JSON.
+  void ReportJSON();
+
 private:
   vector<Metric*> metrics_;
 };
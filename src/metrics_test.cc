@@ -0,0 +1,72 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "metrics.h"
+
+#include "test.h"
+
+TEST(MetricsTest, Buckets) {
+  for (int bucket = 0; bucket + 1 < Metric::kBuckets; ++bucket) {
+    int64_t start = Metric::BucketStart(bucket);
+    int64_t next = Metric::BucketStart(bucket + 1);
+    ASSERT_LT(start, next);
+    EXPECT_EQ(bucket, Metric::BucketFor(start));
+    EXPECT_EQ(bucket, Metric::BucketFor(next - 1));
+  }
+  EXPECT_EQ(0, Metric::BucketFor(0));
+  EXPECT_EQ(7, Metric::BucketFor(7));
+  EXPECT_EQ(8, Metric::BucketFor(8));
+  EXPECT_EQ(9, Metric::BucketFor(10));
+  EXPECT_EQ(Metric::kBuckets - 1, Metric::BucketFor(INT64_MAX));
+}
+
+TEST(MetricsTest, Percentiles) {
+  Metric metric("test");
+  for (int i = 1; i <= 100; ++i)
+    metric.Record(i, i);
+  EXPECT_EQ(100, metric.count);
+  EXPECT_EQ(5050, metric.sum);
+  EXPECT_EQ(100, metric.max);
+
+  // Percentiles are approximate, but never below the exact value and never
+  // more than a quarter above it.
+  int64_t p50 = metric.Percentile(0.5);
+  EXPECT_GE(p50, 50);
+  EXPECT_LE(p50, 50 + 50 / 4);
+  int64_t p90 = metric.Percentile(0.9);
+  EXPECT_GE(p90, 90);
+  EXPECT_LE(p90, 100);
+  EXPECT_EQ(100, metric.Percentile(0.99));
+  EXPECT_EQ(100, metric.Percentile(1.0));
+}
+
+TEST(MetricsTest, Nesting) {
+  Metric outer("outer");
+  Metric inner("inner");
+  {
+    ScopedMetric outer_scope(&outer);
+    ScopedMetric inner_scope(&inner);
+  }
+  {
+    // Recording "outer" inside of "inner" later doesn't make a cycle.
+    ScopedMetric inner_scope(&inner);
+    ScopedMetric outer_scope(&outer);
+  }
+  EXPECT_EQ(NULL, outer.parent);
+  EXPECT_EQ(&outer, inner.parent);
+  EXPECT_EQ(2, outer.count);
+  EXPECT_EQ(2, inner.count);
+  EXPECT_LE(outer.self_sum, outer.sum);
+  EXPECT_LE(inner.self_sum, inner.sum);
+}
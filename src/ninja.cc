@@ -39,8 +39,10 @@
 #include "disk_interface.h"
 #include "graph.h"
 #include "graphviz.h"
+#include "json.h"
 #include "manifest_parser.h"
 #include "metrics.h"
+#include "query.h"
 #include "state.h"
 #include "util.h"
 #include "version.h"
@@ -113,6 +115,7 @@ struct NinjaMain : public BuildLogUser {
   // The various subcommands, run via "-t XXX".
   int ToolGraph(const Options* options, int argc, char* argv[]);
   int ToolQuery(const Options* options, int argc, char* argv[]);
+  int ToolAffected(const Options* options, int argc, char* argv[]);
   int ToolDeps(const Options* options, int argc, char* argv[]);
   int ToolBrowse(const Options* options, int argc, char* argv[]);
   int ToolMSVC(const Options* options, int argc, char* argv[]);
@@ -131,6 +134,18 @@ struct NinjaMain : public BuildLogUser {
   /// @return false on error.
   bool OpenDepsLog(bool recompact_only = false);
 
+  /// Load the build log without opening it for writing, for tools that
+  /// only read it.
+  /// @return false on error.
+  bool LoadBuildLog();
+
+  /// Load the deps log without opening it for writing.
+  /// @return false on error.
+  bool LoadDepsLog();
+
+  /// @return the path of the log file \a name in the build directory.
+  string LogPath(const char* name);
+
   /// Ensure the build directory exists, creating it if necessary.
   /// @return false on error.
   bool EnsureBuildDirExists();
@@ -327,6 +342,83 @@ bool NinjaMain::CollectTargetsFromArgs(int argc, char* argv[],
 }
 
 int NinjaMain::ToolGraph(const Options* options, int argc, char* argv[]) {
+  // The graph tool uses getopt, and expects argv[0] to contain the name of
+  // the tool, i.e. "graph".
+  argc++;
+  argv--;
+
+  GraphViz graph;
+
+  optind = 1;
+  int opt;
+  while ((opt = getopt(argc, argv, const_cast<char*>("hd:r:x:Hcm:f:"))) != -1) {
+    switch (opt) {
+      case 'd':
+      case 'm': {
+        char* end;
+        int value = strtol(optarg, &end, 10);
+        if (*end != 0 || value < 0) {
+          Error("invalid number '%s'", optarg);
+          return 1;
+        }
+        if (opt == 'd')
+          graph.max_depth_ = value;
+        else
+          graph.min_cost_ms_ = value;
+        break;
+      }
+      case 'r':
+        graph.skip_rules_.insert(optarg);
+        break;
+      case 'x':
+        graph.exclude_paths_.push_back(optarg);
+        break;
+      case 'H':
+        graph.collapse_headers_ = true;
+        break;
+      case 'c':
+        graph.cluster_dirs_ = true;
+        break;
+      case 'f':
+        if (strcmp(optarg, "dot") == 0) {
+          graph.format_ = GraphViz::DOT;
+        } else if (strcmp(optarg, "json") == 0) {
+          graph.format_ = GraphViz::JSON;
+        } else if (strcmp(optarg, "gexf") == 0) {
+          graph.format_ = GraphViz::GEXF;
+        } else {
+          Error("unknown format '%s'", optarg);
+          return 1;
+        }
+        break;
+      case 'h':
+      default:
+        printf(
+"usage: ninja -t graph [options] [targets]\n"
+"\n"
+"options:\n"
+"  -d N       stop N edges away from the targets\n"
+"  -r RULE    don't expand edges using RULE (may be repeated)\n"
+"  -x STRING  leave out files whose path contains STRING (may be repeated)\n"
+"  -H         leave out implicit inputs that aren't built, e.g. headers\n"
+"  -c         group files by directory\n"
+"  -m MS      don't expand edges that took less than MS milliseconds in\n"
+"             the last build\n"
+"  -f FORMAT  output format: dot (default), json or gexf\n"
+               );
+        return 1;
+    }
+  }
+  argv += optind;
+  argc -= optind;
+
+  // Only -m needs the build log, and only to read it.
+  if (graph.min_cost_ms_ > 0) {
+    if (!LoadBuildLog())
+      return 1;
+    graph.build_log_ = &build_log_;
+  }
+
   vector<Node*> nodes;
   string err;
   if (!CollectTargetsFromArgs(argc, argv, &nodes, &err)) {
@@ -334,8 +426,6 @@ int NinjaMain::ToolGraph(const Options* options, int argc, char* argv[]) {
     return 1;
   }
 
-  GraphViz graph;
-  graph.Start();
   for (vector<Node*>::const_iterator n = nodes.begin(); n != nodes.end(); ++n)
     graph.AddTarget(*n);
   graph.Finish();
@@ -343,48 +433,398 @@ int NinjaMain::ToolGraph(const Options* options, int argc, char* argv[]) {
   return 0;
 }
 
+/// What -t query reports about each target.
+enum QueryMode {
+  QUERY_ADJACENT,
+  QUERY_DEPENDENCIES,
+  QUERY_DEPENDENTS
+};
+
+/// Answer a -t query for \a node, appending the answer to \a out.
+void QueryNode(GraphQuery* query, Node* node, QueryMode mode, int max_depth,
+               bool json, string* out) {
+  if (mode != QUERY_ADJACENT) {
+    vector<GraphQuery::Found> found;
+    if (mode == QUERY_DEPENDENCIES)
+      query->Dependencies(node, max_depth, &found);
+    else
+      query->Dependents(node, max_depth, &found);
+    const char* label =
+        mode == QUERY_DEPENDENCIES ? "dependencies" : "dependents";
+    if (json) {
+      *out += "{\"path\": ";
+      AppendJSONPath(node->path(), out);
+      *out += ", \"";
+      *out += label;
+      *out += "\": [";
+      for (vector<GraphQuery::Found>::iterator f = found.begin();
+           f != found.end(); ++f) {
+        if (f != found.begin())
+          *out += ", ";
+        *out += "{\"path\": ";
+        AppendJSONPath(f->first->path(), out);
+        char depth[32];
+        snprintf(depth, sizeof(depth), ", \"depth\": %d}", f->second);
+        *out += depth;
+      }
+      *out += "]}\n";
+    } else {
+      *out += node->path() + ":\n  " + label + ":\n";
+      for (vector<GraphQuery::Found>::iterator f = found.begin();
+           f != found.end(); ++f) {
+        *out += "    " + f->first->path() + "\n";
+      }
+    }
+    return;
+  }
+
+  Edge* edge = node->in_edge();
+  if (!json) {
+    *out += node->path() + ":\n";
+    if (edge) {
+      *out += "  input: " + edge->rule_->name() + "\n";
+      for (int in = 0; in < (int)edge->inputs_.size(); in++) {
+        const char* label = "";
+        if (edge->is_implicit(in))
+          label = "| ";
+        else if (edge->is_order_only(in))
+          label = "|| ";
+        *out += string("    ") + label + edge->inputs_[in]->path() + "\n";
+      }
+    }
+    *out += "  outputs:\n";
+    for (vector<Edge*>::const_iterator e = node->out_edges().begin();
+         e != node->out_edges().end(); ++e) {
+      for (vector<Node*>::iterator o = (*e)->outputs_.begin();
+           o != (*e)->outputs_.end(); ++o) {
+        *out += "    " + (*o)->path() + "\n";
+      }
+    }
+    return;
+  }
+
+  *out += "{\"path\": ";
+  AppendJSONPath(node->path(), out);
+  *out += ", \"rule\": ";
+  if (edge)
+    AppendJSONPath(edge->rule_->name(), out);
+  else
+    *out += "null";
+  *out += ", \"inputs\": [";
+  if (edge) {
+    for (int in = 0; in < (int)edge->inputs_.size(); in++) {
+      if (in != 0)
+        *out += ", ";
+      *out += "{\"path\": ";
+      AppendJSONPath(edge->inputs_[in]->path(), out);
+      *out += ", \"type\": \"";
+      *out += InputType(edge, in);
+      *out += "\"}";
+    }
+  }
+  *out += "], \"outputs\": ";
+  vector<Node*> outputs;
+  for (vector<Edge*>::const_iterator e = node->out_edges().begin();
+       e != node->out_edges().end(); ++e) {
+    outputs.insert(outputs.end(), (*e)->outputs_.begin(),
+                   (*e)->outputs_.end());
+  }
+  AppendJSONPaths(outputs, out);
+  *out += ", \"discovered_inputs\": ";
+  AppendJSONPaths(query->DiscoveredInputs(node), out);
+  *out += ", \"discovered_outputs\": ";
+  AppendJSONPaths(query->DiscoveredOutputs(node), out);
+  *out += "}\n";
+}
+
 int NinjaMain::ToolQuery(const Options* options, int argc, char* argv[]) {
-  if (argc == 0) {
+  // The query tool uses getopt, and expects argv[0] to contain the name of
+  // the tool, i.e. "query".
+  argc++;
+  argv--;
+
+  bool from_stdin = false;
+  bool json = false;
+  QueryMode mode = QUERY_ADJACENT;
+  int max_depth = 0;
+
+  optind = 1;
+  int opt;
+  while ((opt = getopt(argc, argv, const_cast<char*>("hsjiod:"))) != -1) {
+    switch (opt) {
+      case 's':
+        from_stdin = true;
+        break;
+      case 'j':
+        json = true;
+        break;
+      case 'i':
+        mode = QUERY_DEPENDENCIES;
+        break;
+      case 'o':
+        mode = QUERY_DEPENDENTS;
+        break;
+      case 'd': {
+        char* end;
+        max_depth = strtol(optarg, &end, 10);
+        if (*end != 0 || max_depth < 0) {
+          Error("invalid depth '%s'", optarg);
+          return 1;
+        }
+        break;
+      }
+      case 'h':
+      default:
+        printf(
+"usage: ninja -t query [options] [targets]\n"
+"\n"
+"options:\n"
+"  -s     also read targets from stdin, one per line\n"
+"  -j     print one line of JSON per target\n"
+"  -i     list everything the targets depend on, transitively\n"
+"  -o     list everything depending on the targets, transitively\n"
+"  -d N   with -i or -o, stop N steps away from the targets\n"
+"\n"
+"Dependencies discovered through the deps log are included.\n"
+               );
+        return 1;
+    }
+  }
+  argv += optind;
+  argc -= optind;
+
+  if (argc == 0 && !from_stdin) {
     Error("expected a target to query");
     return 1;
   }
 
-  for (int i = 0; i < argc; ++i) {
+  GraphQuery query(&deps_log_);
+  int status = 0;
+  string out;
+  string line;
+  for (int i = 0; ; ++i) {
+    const char* target;
+    if (i < argc) {
+      target = argv[i];
+    } else if (from_stdin && ReadLine(stdin, &line)) {
+      if (line.empty())
+        continue;
+      target = line.c_str();
+    } else {
+      break;
+    }
+
     string err;
-    Node* node = CollectTarget(argv[i], &err);
-    if (!node) {
+    Node* node = CollectTarget(target, &err);
+    if (node) {
+      QueryNode(&query, node, mode, max_depth, json, &out);
+    } else if (json) {
+      out += "{\"path\": ";
+      AppendJSONPath(target, &out);
+      out += ", \"error\": ";
+      AppendJSONPath(err, &out);
+      out += "}\n";
+      status = 1;
+    } else {
+      fwrite(out.data(), 1, out.size(), stdout);
+      out.clear();
+      fflush(stdout);
+      Error("%s", err.c_str());
+      status = 1;
+    }
+
+    // Answer stdin queries right away, so that a script can feed queries
+    // and read answers one at a time.
+    if (i >= argc || out.size() >= (1 << 16)) {
+      fwrite(out.data(), 1, out.size(), stdout);
+      out.clear();
+      if (i >= argc)
+        fflush(stdout);
+    }
+  }
+  fwrite(out.data(), 1, out.size(), stdout);
+  return status;
+}
+
+int NinjaMain::ToolAffected(const Options* options, int argc, char* argv[]) {
+  // The affected tool uses getopt, and expects argv[0] to contain the name of
+  // the tool, i.e. "affected".
+  argc++;
+  argv--;
+
+  bool print_edges = false;
+  bool weighted = false;
+
+  optind = 1;
+  int opt;
+  while ((opt = getopt(argc, argv, const_cast<char*>("hew"))) != -1) {
+    switch (opt) {
+      case 'e':
+        print_edges = true;
+        break;
+      case 'w':
+        weighted = true;
+        break;
+      case 'h':
+      default:
+        printf(
+"usage: ninja -t affected [options] [paths]\n"
+"\n"
+"Reads changed paths from stdin, one per line, if none are given, and\n"
+"prints the outputs that would be rebuilt.\n"
+"\n"
+"options:\n"
+"  -e     print one line per command to run: its rule and outputs\n"
+"  -w     prefix each line with the command's last duration in ms from\n"
+"         the build log, and end with the total\n"
+               );
+        return 1;
+    }
+  }
+  argv += optind;
+  argc -= optind;
+
+  // Only read the logs; only -w needs the build log.
+  if (!LoadDepsLog() || (weighted && !LoadBuildLog()))
+    return 1;
+
+  vector<string> paths(argv, argv + argc);
+  if (paths.empty()) {
+    string line;
+    while (ReadLine(stdin, &line)) {
+      if (!line.empty())
+        paths.push_back(line);
+    }
+  }
+
+  // Paths that aren't in the graph can't affect it.
+  vector<Node*> changed;
+  for (vector<string>::iterator path = paths.begin(); path != paths.end();
+       ++path) {
+    uint64_t slash_bits;
+    string err;
+    if (!CanonicalizePath(&*path, &slash_bits, &err)) {
       Error("%s", err.c_str());
       return 1;
     }
+    if (Node* node = state_.LookupNode(*path))
+      changed.push_back(node);
+  }
 
-    printf("%s:\n", node->path().c_str());
-    if (Edge* edge = node->in_edge()) {
-      printf("  input: %s\n", edge->rule_->name().c_str());
-      for (int in = 0; in < (int)edge->inputs_.size(); in++) {
-        const char* label = "";
-        if (edge->is_implicit(in))
-          label = "| ";
-        else if (edge->is_order_only(in))
-          label = "|| ";
-        printf("    %s%s\n", label, edge->inputs_[in]->path().c_str());
+  GraphQuery query(&deps_log_);
+  vector<Edge*> edges;
+  query.Affected(changed, &edges);
+
+  string out;
+  int64_t total_ms = 0;
+  for (vector<Edge*>::iterator e = edges.begin(); e != edges.end(); ++e) {
+    if (weighted) {
+      int duration = 0;
+      for (vector<Node*>::iterator o = (*e)->outputs_.begin();
+           o != (*e)->outputs_.end(); ++o) {
+        if (BuildLog::LogEntry* entry =
+                build_log_.LookupByOutput((*o)->path())) {
+          duration = entry->end_time - entry->start_time;
+          break;
+        }
+      }
+      total_ms += duration;
+      char prefix[32];
+      snprintf(prefix, sizeof(prefix), "%d\t", duration);
+      // Every line of this edge gets the edge's duration.
+      if (!print_edges) {
+        for (vector<Node*>::iterator o = (*e)->outputs_.begin();
+             o != (*e)->outputs_.end(); ++o) {
+          out += prefix + (*o)->path() + "\n";
+        }
+        continue;
       }
+      out += prefix;
     }
-    printf("  outputs:\n");
-    for (vector<Edge*>::const_iterator edge = node->out_edges().begin();
-         edge != node->out_edges().end(); ++edge) {
-      for (vector<Node*>::iterator out = (*edge)->outputs_.begin();
-           out != (*edge)->outputs_.end(); ++out) {
-        printf("    %s\n", (*out)->path().c_str());
+    if (print_edges) {
+      out += (*e)->rule_->name();
+      for (vector<Node*>::iterator o = (*e)->outputs_.begin();
+           o != (*e)->outputs_.end(); ++o) {
+        out += " " + (*o)->path();
+      }
+      out += "\n";
+    } else {
+      for (vector<Node*>::iterator o = (*e)->outputs_.begin();
+           o != (*e)->outputs_.end(); ++o) {
+        out += (*o)->path() + "\n";
       }
     }
   }
+  if (weighted) {
+    char total[64];
+    snprintf(total, sizeof(total), "%" PRId64 "\ttotal\n", total_ms);
+    out += total;
+  }
+  fwrite(out.data(), 1, out.size(), stdout);
   return 0;
 }
 
 #if defined(NINJA_HAVE_BROWSE)
 int NinjaMain::ToolBrowse(const Options* options, int argc, char* argv[]) {
-  RunBrowsePython(&state_, ninja_command_, options->input_file, argc, argv);
-  // If we get here, the browse failed.
+  // The browse tool uses getopt, and expects argv[0] to contain the name of
+  // the tool, i.e. "browse".
+  argc++;
+  argv--;
+
+  string hostname = "localhost";
+  int port = 8000;
+  bool open_browser = true;
+
+  const option kLongOptions[] = {
+    { "port", required_argument, NULL, 'p' },
+    { "hostname", required_argument, NULL, 'a' },
+    { "no-browser", no_argument, NULL, 'n' },
+    { "help", no_argument, NULL, 'h' },
+    { NULL, 0, NULL, 0 }
+  };
+  optind = 1;
+  int opt;
+  while ((opt = getopt_long(argc, argv, "p:a:h", kLongOptions, NULL)) != -1) {
+    switch (opt) {
+      case 'p': {
+        char* end;
+        port = strtol(optarg, &end, 10);
+        if (*end != 0 || port <= 0 || port > 65535) {
+          Error("invalid port '%s'", optarg);
+          return 1;
+        }
+        break;
+      }
+      case 'a':
+        hostname = optarg;
+        break;
+      case 'n':
+        open_browser = false;
+        break;
+      case 'h':
+      default:
+        printf(
+"usage: ninja -t browse [options] [target]\n"
+"\n"
+"options:\n"
+"  -p, --port=PORT          port number to use (default 8000)\n"
+"  -a, --hostname=HOSTNAME  hostname to bind to (default localhost)\n"
+"  --no-browser             do not open a web browser on startup\n"
+               );
+        return 1;
+    }
+  }
+  argv += optind;
+  argc -= optind;
+
+  // Only read the logs, so that browsing never changes them.
+  if (!LoadBuildLog() || !LoadDepsLog())
+    return 1;
+
+  BrowseServer server(&state_, &build_log_, &deps_log_,
+                      argc > 0 ? argv[0] : "all");
+  // Serve() only returns on error.
+  server.Serve(hostname, port, open_browser);
   return 1;
 }
 #endif  // _WIN32
@@ -466,13 +906,37 @@ int ToolTargetsList(State* state) {
 }
 
 int NinjaMain::ToolDeps(const Options* options, int argc, char** argv) {
+  // The deps tool uses getopt, and expects argv[0] to contain the name of
+  // the tool, i.e. "deps".
+  argc++;
+  argv--;
+
+  bool json = false;
+
+  optind = 1;
+  int opt;
+  while ((opt = getopt(argc, argv, const_cast<char*>("hj"))) != -1) {
+    switch (opt) {
+      case 'j':
+        json = true;
+        break;
+      case 'h':
+      default:
+        printf(
+"usage: ninja -t deps [options] [targets]\n"
+"\n"
+"options:\n"
+"  -j     print one line of JSON per target\n"
+               );
+        return 1;
+    }
+  }
+  argv += optind;
+  argc -= optind;
+
   vector<Node*> nodes;
   if (argc == 0) {
-    for (vector<Node*>::const_iterator ni = deps_log_.nodes().begin();
-         ni != deps_log_.nodes().end(); ++ni) {
-      if (deps_log_.IsDepsEntryLiveFor(*ni))
-        nodes.push_back(*ni);
-    }
+    CollectDepsNodes(&deps_log_, &nodes);
   } else {
     string err;
     if (!CollectTargetsFromArgs(argc, argv, &nodes, &err)) {
@@ -481,26 +945,18 @@ int NinjaMain::ToolDeps(const Options* options, int argc, char** argv) {
     }
   }
 
-  RealDiskInterface disk_interface;
+  // Where supported, stat whole directories at once.
+  disk_interface_.AllowStatCache(true);
+  string out;
   for (vector<Node*>::iterator it = nodes.begin(), end = nodes.end();
        it != end; ++it) {
-    DepsLog::Deps* deps = deps_log_.GetDeps(*it);
-    if (!deps) {
-      printf("%s: deps not found\n", (*it)->path().c_str());
-      continue;
+    AppendDepsEntry(&deps_log_, &disk_interface_, *it, json, &out);
+    if (out.size() >= (1 << 16)) {
+      fwrite(out.data(), 1, out.size(), stdout);
+      out.clear();
     }
-
-    string err;
-    TimeStamp mtime = disk_interface.Stat((*it)->path(), &err);
-    if (mtime == -1)
-      Error("%s", err.c_str());  // Log and ignore Stat() errors;
-    printf("%s: #deps %d, deps mtime %" PRId64 " (%s)\n",
-           (*it)->path().c_str(), deps->node_count, deps->mtime,
-           (!mtime || mtime > deps->mtime ? "STALE":"VALID"));
-    for (int i = 0; i < deps->node_count; ++i)
-      printf("    %s\n", deps->nodes[i]->path().c_str());
-    printf("\n");
   }
+  fwrite(out.data(), 1, out.size(), stdout);
 
   return 0;
 }
@@ -653,15 +1109,6 @@ int NinjaMain::ToolClean(const Options* options, int argc, char* argv[]) {
   }
 }
 
-void EncodeJSONString(const char *str) {
-  while (*str) {
-    if (*str == '"' || *str == '\\')
-      putchar('\\');
-    putchar(*str);
-    str++;
-  }
-}
-
 enum EvaluateCommandMode {
   ECM_NORMAL,
   ECM_EXPAND_RSPFILE
@@ -698,22 +1145,29 @@ int NinjaMain::ToolCompilationDatabase(const Options* options, int argc,
   argv--;
 
   EvaluateCommandMode eval_mode = ECM_NORMAL;
+  const char* output_path = NULL;
 
   optind = 1;
   int opt;
-  while ((opt = getopt(argc, argv, const_cast<char*>("hx"))) != -1) {
+  while ((opt = getopt(argc, argv, const_cast<char*>("hxo:"))) != -1) {
     switch(opt) {
       case 'x':
         eval_mode = ECM_EXPAND_RSPFILE;
         break;
 
+      case 'o':
+        output_path = optarg;
+        break;
+
       case 'h':
       default:
         printf(
             "usage: ninja -t compdb [options] [rules]\n"
             "\n"
             "options:\n"
-            "  -x     expand @rspfile style response file invocations\n"
+            "  -x       expand @rspfile style response file invocations\n"
+            "  -o FILE  write to FILE instead of stdout, leaving it untouched\n"
+            "           if its contents would not change\n"
             );
         return 1;
     }
@@ -733,7 +1187,12 @@ int NinjaMain::ToolCompilationDatabase(const Options* options, int argc,
     return 1;
   }
 
-  putchar('[');
+  // The entries are built up in memory and written out in large chunks; the
+  // directory is the same for every entry, so it is only escaped once.
+  string directory;
+  EncodeJSONString(&cwd[0], &directory);
+  const size_t kChunkSize = 1 << 16;
+  string out = "[";
   for (vector<Edge*>::iterator e = state_.edges_.begin();
        e != state_.edges_.end(); ++e) {
     if ((*e)->inputs_.empty())
@@ -741,24 +1200,42 @@ int NinjaMain::ToolCompilationDatabase(const Options* options, int argc,
     for (int i = 0; i != argc; ++i) {
       if ((*e)->rule_->name() == argv[i]) {
         if (!first)
-          putchar(',');
-
-        printf("\n  {\n    \"directory\": \"");
-        EncodeJSONString(&cwd[0]);
-        printf("\",\n    \"command\": \"");
-        EncodeJSONString(EvaluateCommandWithRspfile(*e, eval_mode).c_str());
-        printf("\",\n    \"file\": \"");
-        EncodeJSONString((*e)->inputs_[0]->path().c_str());
-        printf("\",\n    \"output\": \"");
-        EncodeJSONString((*e)->outputs_[0]->path().c_str());
-        printf("\"\n  }");
+          out += ',';
+
+        out += "\n  {\n    \"directory\": \"";
+        out += directory;
+        out += "\",\n    \"command\": \"";
+        EncodeJSONString(EvaluateCommandWithRspfile(*e, eval_mode), &out);
+        out += "\",\n    \"file\": \"";
+        EncodeJSONString((*e)->inputs_[0]->path(), &out);
+        out += "\",\n    \"output\": \"";
+        EncodeJSONString((*e)->outputs_[0]->path(), &out);
+        out += "\"\n  }";
 
         first = false;
       }
     }
+    if (!output_path && out.size() >= kChunkSize) {
+      fwrite(out.data(), 1, out.size(), stdout);
+      out.clear();
+    }
   }
+  out += "\n]\n";
 
-  puts("\n]");
+  if (!output_path) {
+    fwrite(out.data(), 1, out.size(), stdout);
+    return 0;
+  }
+
+  // Tools that watch the database re-index everything when it changes, so
+  // don't touch it if nothing in it did.
+  string old_contents, err;
+  if (disk_interface_.ReadFile(output_path, &old_contents, &err) ==
+          DiskInterface::Okay && old_contents == out) {
+    return 0;
+  }
+  if (!disk_interface_.WriteFile(output_path, out))
+    return 1;
   return 0;
 }
 
@@ -821,6 +1298,8 @@ const Tool* ChooseTool(const string& tool_name) {
       Tool::RUN_AFTER_LOAD, &NinjaMain::ToolGraph },
     { "query", "show inputs/outputs for a path",
       Tool::RUN_AFTER_LOGS, &NinjaMain::ToolQuery },
+    { "affected", "list what would rebuild if the given files changed",
+      Tool::RUN_AFTER_LOAD, &NinjaMain::ToolAffected },
     { "targets",  "list targets by their rule or depth in the DAG",
       Tool::RUN_AFTER_LOAD, &NinjaMain::ToolTargets },
     { "compdb",  "dump JSON compilation database to stdout",
@@ -865,6 +1344,7 @@ bool DebugEnable(const string& name) {
   if (name == "list") {
     printf("debugging modes:\n"
 "  stats        print operation counts/timing info\n"
+"  stats=json   print them as JSON\n"
 "  explain      explain what caused a command to execute\n"
 "  keepdepfile  don't delete depfiles after they're read by ninja\n"
 "  keeprsp      don't delete @response files on success\n"
@@ -873,8 +1353,9 @@ bool DebugEnable(const string& name) {
 #endif
 "multiple modes can be enabled via -d FOO -d BAR\n");
     return false;
-  } else if (name == "stats") {
+  } else if (name == "stats" || name == "stats=json") {
     g_metrics = new Metrics;
+    g_metrics_json = name == "stats=json";
     return true;
   } else if (name == "explain") {
     g_explaining = true;
@@ -937,11 +1418,15 @@ bool WarningEnable(const string& name, Options* options) {
   }
 }
 
-bool NinjaMain::OpenBuildLog(bool recompact_only) {
-  string log_path = ".ninja_log";
-  if (!build_dir_.empty())
-    log_path = build_dir_ + "/" + log_path;
+string NinjaMain::LogPath(const char* name) {
+  string build_dir = state_.bindings_.LookupVariable("builddir");
+  if (build_dir.empty())
+    return name;
+  return build_dir + "/" + name;
+}
 
+bool NinjaMain::LoadBuildLog() {
+  string log_path = LogPath(".ninja_log");
   string err;
   if (!build_log_.Load(log_path, &err)) {
     Error("loading build log %s: %s", log_path.c_str(), err.c_str());
@@ -950,9 +1435,16 @@ bool NinjaMain::OpenBuildLog(bool recompact_only) {
   if (!err.empty()) {
     // Hack: Load() can return a warning via err by returning true.
     Warning("%s", err.c_str());
-    err.clear();
   }
+  return true;
+}
 
+bool NinjaMain::OpenBuildLog(bool recompact_only) {
+  if (!LoadBuildLog())
+    return false;
+
+  string log_path = LogPath(".ninja_log");
+  string err;
   if (recompact_only) {
     bool success = build_log_.Recompact(log_path, *this, &err);
     if (!success)
@@ -970,13 +1462,8 @@ bool NinjaMain::OpenBuildLog(bool recompact_only) {
   return true;
 }
 
-/// Open the deps log: load it, then open for writing.
-/// @return false on error.
-bool NinjaMain::OpenDepsLog(bool recompact_only) {
-  string path = ".ninja_deps";
-  if (!build_dir_.empty())
-    path = build_dir_ + "/" + path;
-
+bool NinjaMain::LoadDepsLog() {
+  string path = LogPath(".ninja_deps");
   string err;
   if (!deps_log_.Load(path, &state_, &err)) {
     Error("loading deps log %s: %s", path.c_str(), err.c_str());
@@ -985,9 +1472,18 @@ bool NinjaMain::OpenDepsLog(bool recompact_only) {
   if (!err.empty()) {
     // Hack: Load() can return a warning via err by returning true.
     Warning("%s", err.c_str());
-    err.clear();
   }
+  return true;
+}
+
+/// Open the deps log: load it, then open for writing.
+/// @return false on error.
+bool NinjaMain::OpenDepsLog(bool recompact_only) {
+  if (!LoadDepsLog())
+    return false;
 
+  string path = LogPath(".ninja_deps");
+  string err;
   if (recompact_only) {
     bool success = deps_log_.Recompact(path, &err);
     if (!success)
@@ -1006,6 +1502,10 @@ bool NinjaMain::OpenDepsLog(bool recompact_only) {
 }
 
 void NinjaMain::DumpMetrics() {
+  if (g_metrics_json) {
+    g_metrics->ReportJSON();
+    return;
+  }
   g_metrics->Report();
 
   printf("\n");
@@ -1038,16 +1538,9 @@ int NinjaMain::RunBuild(int argc, char** argv) {
   disk_interface_.AllowStatCache(g_experimental_statcache);
 
   Builder builder(&state_, config_, &build_log_, &deps_log_, &disk_interface_);
-  for (size_t i = 0; i < targets.size(); ++i) {
-    if (!builder.AddTarget(targets[i], &err)) {
-      if (!err.empty()) {
-        Error("%s", err.c_str());
-        return 1;
-      } else {
-        // Added a target that is already up-to-date; not really
-        // an error.
-      }
-    }
+  if (!builder.AddTargets(targets, &err)) {
+    Error("%s", err.c_str());
+    return 1;
   }
 
   // Make sure restat rules do not see stale timestamps.
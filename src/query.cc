@@ -0,0 +1,221 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __STDC_FORMAT_MACROS
+#define __STDC_FORMAT_MACROS
+#endif
+
+#include "query.h"
+
+#include <inttypes.h>
+#include <stdio.h>
+
+#include <map>
+#include <set>
+
+#include "deps_log.h"
+#include "disk_interface.h"
+#include "graph.h"
+#include "json.h"
+#include "util.h"
+
+GraphQuery::GraphQuery(DepsLog* deps_log)
+    : deps_log_(deps_log), reverse_index_built_(false) {}
+
+vector<Node*> GraphQuery::DiscoveredInputs(Node* node) const {
+  DepsLog::Deps* deps = deps_log_->GetDeps(node);
+  if (!deps)
+    return vector<Node*>();
+  return vector<Node*>(deps->nodes, deps->nodes + deps->node_count);
+}
+
+const vector<Node*>& GraphQuery::DiscoveredOutputs(Node* node) {
+  if (!reverse_index_built_) {
+    const vector<Node*>& nodes = deps_log_->nodes();
+    const vector<DepsLog::Deps*>& deps = deps_log_->deps();
+    discovered_outputs_.resize(nodes.size());
+    for (size_t id = 0; id < deps.size(); ++id) {
+      if (!deps[id])
+        continue;
+      for (int i = 0; i < deps[id]->node_count; ++i)
+        discovered_outputs_[deps[id]->nodes[i]->id()].push_back(nodes[id]);
+    }
+    reverse_index_built_ = true;
+  }
+  static const vector<Node*> kNone;
+  int id = node->id();
+  if (id < 0 || id >= (int)discovered_outputs_.size())
+    return kNone;
+  return discovered_outputs_[id];
+}
+
+void GraphQuery::Dependencies(Node* node, int max_depth,
+                              vector<Found>* result) {
+  Walk(node, false, max_depth, result);
+}
+
+void GraphQuery::Dependents(Node* node, int max_depth,
+                            vector<Found>* result) {
+  Walk(node, true, max_depth, result);
+}
+
+void GraphQuery::Neighbors(Node* node, bool dependents, vector<Node*>* next) {
+  if (dependents) {
+    for (vector<Edge*>::const_iterator e = node->out_edges().begin();
+         e != node->out_edges().end(); ++e) {
+      next->insert(next->end(), (*e)->outputs_.begin(), (*e)->outputs_.end());
+    }
+    const vector<Node*>& discovered = DiscoveredOutputs(node);
+    next->insert(next->end(), discovered.begin(), discovered.end());
+  } else {
+    if (Edge* edge = node->in_edge())
+      next->insert(next->end(), edge->inputs_.begin(), edge->inputs_.end());
+    if (DepsLog::Deps* deps = deps_log_->GetDeps(node))
+      next->insert(next->end(), deps->nodes, deps->nodes + deps->node_count);
+  }
+}
+
+void GraphQuery::Walk(Node* node, bool dependents, int max_depth,
+                      vector<Found>* result) {
+  set<Node*> seen;
+  seen.insert(node);
+  vector<Node*> frontier(1, node);
+  vector<Node*> next;
+  for (int depth = 1; !frontier.empty(); ++depth) {
+    if (max_depth > 0 && depth > max_depth)
+      break;
+    next.clear();
+    for (vector<Node*>::iterator n = frontier.begin(); n != frontier.end();
+         ++n) {
+      Neighbors(*n, dependents, &next);
+    }
+    frontier.clear();
+    for (vector<Node*>::iterator n = next.begin(); n != next.end(); ++n) {
+      if (seen.insert(*n).second) {
+        frontier.push_back(*n);
+        result->push_back(Found(*n, depth));
+      }
+    }
+  }
+}
+
+void GraphQuery::Affected(const vector<Node*>& changed,
+                          vector<Edge*>* edges) {
+  set<Node*> seen_nodes(changed.begin(), changed.end());
+  set<Edge*> seen_edges;
+  // The inputs that aren't order-only, for edges that also have order-only
+  // inputs.  Collected once per edge, so that wide edges reached through
+  // many of their inputs aren't scanned again each time.
+  map<Edge*, set<Node*> > dirtying_inputs;
+  vector<Node*> queue(changed.begin(), changed.end());
+  vector<Edge*> candidates;
+  for (size_t i = 0; i < queue.size(); ++i) {
+    Node* node = queue[i];
+    candidates.clear();
+    for (vector<Edge*>::const_iterator e = node->out_edges().begin();
+         e != node->out_edges().end(); ++e) {
+      if (seen_edges.count(*e))
+        continue;
+      // The node may be listed more than once; any use that isn't
+      // order-only makes the edge dirty.
+      if ((*e)->order_only_deps_) {
+        map<Edge*, set<Node*> >::iterator inputs = dirtying_inputs.find(*e);
+        if (inputs == dirtying_inputs.end()) {
+          inputs = dirtying_inputs.insert(make_pair(*e, set<Node*>())).first;
+          inputs->second.insert(
+              (*e)->inputs_.begin(),
+              (*e)->inputs_.end() - (*e)->order_only_deps_);
+        }
+        if (!inputs->second.count(node))
+          continue;
+      }
+      candidates.push_back(*e);
+    }
+    const vector<Node*>& discovered = DiscoveredOutputs(node);
+    for (vector<Node*>::const_iterator out = discovered.begin();
+         out != discovered.end(); ++out) {
+      // Outputs that are no longer built can be left in the deps log.
+      if (Edge* edge = (*out)->in_edge())
+        candidates.push_back(edge);
+    }
+
+    for (vector<Edge*>::iterator e = candidates.begin(); e != candidates.end();
+         ++e) {
+      if (!seen_edges.insert(*e).second)
+        continue;
+      edges->push_back(*e);
+      for (vector<Node*>::iterator out = (*e)->outputs_.begin();
+           out != (*e)->outputs_.end(); ++out) {
+        if (seen_nodes.insert(*out).second)
+          queue.push_back(*out);
+      }
+    }
+  }
+}
+
+const char* InputType(Edge* edge, size_t index) {
+  if (edge->is_order_only(index))
+    return "order-only";
+  if (edge->is_implicit(index))
+    return "implicit";
+  return "explicit";
+}
+
+void CollectDepsNodes(DepsLog* deps_log, vector<Node*>* nodes) {
+  for (vector<Node*>::const_iterator ni = deps_log->nodes().begin();
+       ni != deps_log->nodes().end(); ++ni) {
+    if (deps_log->IsDepsEntryLiveFor(*ni))
+      nodes->push_back(*ni);
+  }
+}
+
+void AppendDepsEntry(DepsLog* deps_log, DiskInterface* disk_interface,
+                     Node* node, bool json, string* out) {
+  DepsLog::Deps* deps = deps_log->GetDeps(node);
+  if (!deps) {
+    if (json) {
+      *out += "{\"output\": ";
+      AppendJSONPath(node->path(), out);
+      *out += ", \"deps\": null}\n";
+    } else {
+      *out += node->path() + ": deps not found\n";
+    }
+    return;
+  }
+
+  string err;
+  TimeStamp mtime = disk_interface->Stat(node->path(), &err);
+  if (mtime == -1)
+    Error("%s", err.c_str());  // Log and ignore Stat() errors;
+  const char* status = !mtime || mtime > deps->mtime ? "STALE" : "VALID";
+  char buf[128];
+  if (json) {
+    *out += "{\"output\": ";
+    AppendJSONPath(node->path(), out);
+    snprintf(buf, sizeof(buf), ", \"mtime\": %" PRId64 ", \"status\": \"%s\""
+             ", \"deps\": ", deps->mtime, status);
+    *out += buf;
+    AppendJSONPaths(
+        vector<Node*>(deps->nodes, deps->nodes + deps->node_count), out);
+    *out += "}\n";
+  } else {
+    *out += node->path();
+    snprintf(buf, sizeof(buf), ": #deps %d, deps mtime %" PRId64 " (%s)\n",
+             deps->node_count, deps->mtime, status);
+    *out += buf;
+    for (int i = 0; i < deps->node_count; ++i)
+      *out += "    " + deps->nodes[i]->path() + "\n";
+    *out += "\n";
+  }
+}
@@ -0,0 +1,89 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef NINJA_QUERY_H_
+#define NINJA_QUERY_H_
+
+#include <string>
+#include <utility>
+#include <vector>
+using namespace std;
+
+struct DepsLog;
+struct DiskInterface;
+struct Edge;
+struct Node;
+
+/// Answers questions about the loaded graph that take both the manifest
+/// and the dependencies discovered in the deps log into account, for
+/// tools like -t query and -t browse.
+struct GraphQuery {
+  explicit GraphQuery(DepsLog* deps_log);
+
+  /// A node found by a transitive query, and its distance from the start.
+  typedef pair<Node*, int> Found;
+
+  /// @return the dependencies \a node's deps log entry lists.
+  vector<Node*> DiscoveredInputs(Node* node) const;
+
+  /// @return the outputs whose deps log entries list \a node.
+  /// The reverse index behind this is built on first use.
+  const vector<Node*>& DiscoveredOutputs(Node* node);
+
+  /// Collect everything \a node depends on: the inputs of its in edge and
+  /// its discovered inputs, transitively, in breadth-first order.
+  /// \a max_depth limits the distance; 0 means no limit.
+  void Dependencies(Node* node, int max_depth, vector<Found>* result);
+
+  /// Collect everything depending on \a node: the outputs of its out edges
+  /// and its discovered outputs, transitively, in breadth-first order.
+  /// \a max_depth limits the distance; 0 means no limit.
+  void Dependents(Node* node, int max_depth, vector<Found>* result);
+
+  /// Collect the edges that would have to run if the files \a changed
+  /// changed: edges with one of them as an input or a discovered input, the
+  /// edges using those edges' outputs, and so on.  Changes to order-only
+  /// inputs don't make edges run.  Apart from building the reverse index,
+  /// this only visits the affected part of the graph.  Edges are in
+  /// breadth-first order.
+  void Affected(const vector<Node*>& changed, vector<Edge*>* edges);
+
+ private:
+  /// Append the nodes adjacent to \a node in the given direction to
+  /// \a next.
+  void Neighbors(Node* node, bool dependents, vector<Node*>* next);
+  void Walk(Node* node, bool dependents, int max_depth,
+            vector<Found>* result);
+
+  DepsLog* deps_log_;
+  bool reverse_index_built_;
+  /// Indexed by Node::id(), which every node in the deps log has.
+  vector<vector<Node*> > discovered_outputs_;
+};
+
+/// @return "explicit", "implicit" or "order-only", the kind of input
+/// \a index of \a edge, as shown by -t query and -t browse.
+const char* InputType(Edge* edge, size_t index);
+
+/// Collect the nodes -t deps lists when given no targets: those in the
+/// deps log that are built by a rule with deps, with or without an entry.
+void CollectDepsNodes(DepsLog* deps_log, vector<Node*>* nodes);
+
+/// Append what -t deps prints for \a node to \a out: its deps log entry
+/// and whether the entry is older than the output on \a disk_interface,
+/// or that it has none.  With \a json, print one line of JSON instead.
+void AppendDepsEntry(DepsLog* deps_log, DiskInterface* disk_interface,
+                     Node* node, bool json, string* out);
+
+#endif  // NINJA_QUERY_H_
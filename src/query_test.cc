@@ -0,0 +1,236 @@
+// Copyright 2018 Google Inc. All Rights Reserved.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "query.h"
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#include "deps_log.h"
+#include "graph.h"
+#include "test.h"
+
+namespace {
+
+const char kTestFilename[] = "QueryTest-tempfile";
+
+struct QueryTest : public StateTestWithBuiltinRules {
+  virtual void SetUp() {
+    unlink(kTestFilename);
+    ASSERT_NO_FATAL_FAILURE(AssertParse(&state_,
+"build a.o: cat a.c\n"
+"build b.o: cat b.c\n"
+"build lib: cat a.o b.o\n"
+"build app: cat main.o lib\n"
+"build main.o: cat main.c\n"));
+
+    // a.c and main.c include common.h, which includes base.h.
+    string err;
+    ASSERT_TRUE(deps_log_.OpenForWrite(kTestFilename, &err));
+    vector<Node*> deps;
+    deps.push_back(state_.GetNode("common.h", 0));
+    deps.push_back(state_.GetNode("base.h", 0));
+    ASSERT_TRUE(deps_log_.RecordDeps(GetNode("a.o"), 1, deps));
+    ASSERT_TRUE(deps_log_.RecordDeps(GetNode("main.o"), 1, deps));
+  }
+  virtual void TearDown() {
+    deps_log_.Close();
+    unlink(kTestFilename);
+  }
+
+  /// Format the result of a transitive query as "path:depth ...".
+  string Format(const vector<GraphQuery::Found>& found) {
+    string result;
+    for (size_t i = 0; i < found.size(); ++i) {
+      char depth[16];
+      snprintf(depth, sizeof(depth), ":%d", found[i].second);
+      if (i != 0)
+        result += " ";
+      result += found[i].first->path() + depth;
+    }
+    return result;
+  }
+
+  DepsLog deps_log_;
+  VirtualFileSystem fs_;
+};
+
+TEST_F(QueryTest, Discovered) {
+  GraphQuery query(&deps_log_);
+  ASSERT_EQ(2u, query.DiscoveredInputs(GetNode("a.o")).size());
+  EXPECT_EQ(0u, query.DiscoveredInputs(GetNode("b.o")).size());
+
+  const vector<Node*>& users = query.DiscoveredOutputs(GetNode("base.h"));
+  ASSERT_EQ(2u, users.size());
+  EXPECT_EQ("a.o", users[0]->path());
+  EXPECT_EQ("main.o", users[1]->path());
+  // Nodes unknown to the deps log have no discovered outputs.
+  EXPECT_EQ(0u, query.DiscoveredOutputs(GetNode("a.c")).size());
+}
+
+TEST_F(QueryTest, Dependents) {
+  GraphQuery query(&deps_log_);
+  vector<GraphQuery::Found> found;
+  query.Dependents(GetNode("base.h"), 0, &found);
+  EXPECT_EQ("a.o:1 main.o:1 lib:2 app:2", Format(found));
+
+  found.clear();
+  query.Dependents(GetNode("base.h"), 1, &found);
+  EXPECT_EQ("a.o:1 main.o:1", Format(found));
+
+  found.clear();
+  query.Dependents(GetNode("app"), 0, &found);
+  EXPECT_EQ("", Format(found));
+}
+
+TEST_F(QueryTest, Dependencies) {
+  GraphQuery query(&deps_log_);
+  vector<GraphQuery::Found> found;
+  query.Dependencies(GetNode("lib"), 0, &found);
+  EXPECT_EQ("a.o:1 b.o:1 a.c:2 common.h:2 base.h:2 b.c:2", Format(found));
+
+  found.clear();
+  query.Dependencies(GetNode("app"), 1, &found);
+  EXPECT_EQ("main.o:1 lib:1", Format(found));
+}
+
+TEST_F(QueryTest, Affected) {
+  ASSERT_NO_FATAL_FAILURE(AssertParse(&state_,
+"build gen.h: cat gen.in\n"
+"build c.o: cat c.c || gen.h\n"));
+  GraphQuery query(&deps_log_);
+  vector<Node*> changed;
+  changed.push_back(GetNode("base.h"));
+  vector<Edge*> edges;
+  query.Affected(changed, &edges);
+  ASSERT_EQ(4u, edges.size());
+  EXPECT_EQ("a.o", edges[0]->outputs_[0]->path());
+  EXPECT_EQ("main.o", edges[1]->outputs_[0]->path());
+  EXPECT_EQ("lib", edges[2]->outputs_[0]->path());
+  EXPECT_EQ("app", edges[3]->outputs_[0]->path());
+
+  // Only the edge generating gen.h runs, not the one order-only
+  // depending on it.
+  changed.clear();
+  changed.push_back(GetNode("gen.in"));
+  edges.clear();
+  query.Affected(changed, &edges);
+  ASSERT_EQ(1u, edges.size());
+  EXPECT_EQ("gen.h", edges[0]->outputs_[0]->path());
+
+  // Files not in the graph affect nothing.
+  changed.clear();
+  changed.push_back(state_.GetNode("README", 0));
+  edges.clear();
+  query.Affected(changed, &edges);
+  EXPECT_EQ(0u, edges.size());
+}
+
+TEST_F(QueryTest, AffectedWideFanIn) {
+  const int kInputs = 2000;
+  string manifest = "build wide: cat";
+  for (int i = 0; i < kInputs; ++i) {
+    char name[32];
+    snprintf(name, sizeof(name), " in%d", i);
+    manifest += name;
+  }
+  manifest += " ||";
+  for (int i = 0; i < kInputs; ++i) {
+    char name[32];
+    snprintf(name, sizeof(name), " oo%d", i);
+    manifest += name;
+  }
+  manifest += "\nbuild after: cat wide\n";
+  ASSERT_NO_FATAL_FAILURE(AssertParse(&state_, manifest.c_str()));
+  GraphQuery query(&deps_log_);
+
+  // Changing every order-only input affects nothing.
+  vector<Node*> changed;
+  for (int i = 0; i < kInputs; ++i) {
+    char name[32];
+    snprintf(name, sizeof(name), "oo%d", i);
+    changed.push_back(GetNode(name));
+  }
+  vector<Edge*> edges;
+  query.Affected(changed, &edges);
+  EXPECT_EQ(0u, edges.size());
+
+  // Changing every input reports the wide edge once.
+  for (int i = 0; i < kInputs; ++i) {
+    char name[32];
+    snprintf(name, sizeof(name), "in%d", i);
+    changed.push_back(GetNode(name));
+  }
+  query.Affected(changed, &edges);
+  ASSERT_EQ(2u, edges.size());
+  EXPECT_EQ("wide", edges[0]->outputs_[0]->path());
+  EXPECT_EQ("after", edges[1]->outputs_[0]->path());
+}
+
+TEST_F(QueryTest, DepsNodes) {
+  ASSERT_NO_FATAL_FAILURE(AssertParse(&state_,
+"rule cc\n"
+"  command = cc $in\n"
+"  deps = gcc\n"
+"build x.o: cc x.c\n"
+"build gen.h: cc gen.in\n"));
+  // gen.h is only in the log as a dependency, yet it has a rule with deps.
+  vector<Node*> deps;
+  deps.push_back(GetNode("gen.h"));
+  ASSERT_TRUE(deps_log_.RecordDeps(GetNode("x.o"), 1, deps));
+
+  vector<Node*> nodes;
+  CollectDepsNodes(&deps_log_, &nodes);
+  ASSERT_EQ(2u, nodes.size());
+  EXPECT_EQ("x.o", nodes[0]->path());
+  EXPECT_EQ("gen.h", nodes[1]->path());
+
+  string out;
+  AppendDepsEntry(&deps_log_, &fs_, nodes[1], false, &out);
+  EXPECT_EQ("gen.h: deps not found\n", out);
+}
+
+TEST_F(QueryTest, DepsEntry) {
+  fs_.Create("a.o", "");  // As old as its deps log entry.
+  fs_.Tick();
+  fs_.Create("main.o", "");  // Changed since.
+
+  string out;
+  AppendDepsEntry(&deps_log_, &fs_, GetNode("a.o"), false, &out);
+  AppendDepsEntry(&deps_log_, &fs_, GetNode("main.o"), false, &out);
+  AppendDepsEntry(&deps_log_, &fs_, GetNode("lib"), false, &out);
+  EXPECT_EQ(
+"a.o: #deps 2, deps mtime 1 (VALID)\n"
+"    common.h\n"
+"    base.h\n"
+"\n"
+"main.o: #deps 2, deps mtime 1 (STALE)\n"
+"    common.h\n"
+"    base.h\n"
+"\n"
+"lib: deps not found\n", out);
+
+  // A missing output is stale too.
+  fs_.RemoveFile("a.o");
+  out.clear();
+  AppendDepsEntry(&deps_log_, &fs_, GetNode("a.o"), true, &out);
+  AppendDepsEntry(&deps_log_, &fs_, GetNode("lib"), true, &out);
+  EXPECT_EQ(
+"{\"output\": \"a.o\", \"mtime\": 1, \"status\": \"STALE\", "
+"\"deps\": [\"common.h\", \"base.h\"]}\n"
+"{\"output\": \"lib\", \"deps\": null}\n", out);
+}
+
+}  // namespace
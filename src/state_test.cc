@@ -43,4 +43,15 @@ TEST(State, Basic) {
   EXPECT_FALSE(state.GetNode("out", 0)->dirty());
 }
 
+TEST(State, EdgeIds) {
+  State state;
+  Edge* first = state.AddEdge(&State::kPhonyRule);
+  Edge* second = state.AddEdge(&State::kPhonyRule);
+
+  // Edge ids are dense indices into State::edges_.
+  EXPECT_EQ(first, state.edges_[first->id_]);
+  EXPECT_EQ(second, state.edges_[second->id_]);
+  EXPECT_EQ(first->id_ + 1, second->id_);
+}
+
 }  // namespace
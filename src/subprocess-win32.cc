@@ -237,13 +237,18 @@ Subprocess *SubprocessSet::Add(const string& command, bool use_console) {
   return subprocess;
 }
 
-bool SubprocessSet::DoWork() {
+bool SubprocessSet::DoWork(int timeout_millis) {
   DWORD bytes_read;
   Subprocess* subproc;
   OVERLAPPED* overlapped;
 
   if (!GetQueuedCompletionStatus(ioport_, &bytes_read, (PULONG_PTR)&subproc,
-                                 &overlapped, INFINITE)) {
+                                 &overlapped,
+                                 timeout_millis < 0 ? INFINITE
+                                                    : (DWORD)timeout_millis)) {
+    // Nothing was dequeued, so |subproc| wasn't set.
+    if (overlapped == NULL && GetLastError() == WAIT_TIMEOUT)
+      return false;
     if (GetLastError() != ERROR_BROKEN_PIPE)
       Win32Fatal("GetQueuedCompletionStatus");
   }
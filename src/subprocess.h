@@ -79,13 +79,15 @@ struct Subprocess {
 
 /// SubprocessSet runs a ppoll/pselect() loop around a set of Subprocesses.
 /// DoWork() waits for any state change in subprocesses; finished_
-/// is a queue of subprocesses as they finish.
+/// is a queue of subprocesses as they finish.  If \a timeout_millis is not
+/// negative, DoWork() returns after at most that long even if nothing
+/// happened.
 struct SubprocessSet {
   SubprocessSet();
   ~SubprocessSet();
 
   Subprocess* Add(const string& command, bool use_console = false);
-  bool DoWork();
+  bool DoWork(int timeout_millis = -1);
   Subprocess* NextFinished();
   void Clear();
 
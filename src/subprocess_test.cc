@@ -174,6 +174,22 @@ TEST_F(SubprocessTest, SetWithSingle) {
   ASSERT_EQ(1u, subprocs_.finished_.size());
 }
 
+TEST_F(SubprocessTest, Timeout) {
+#ifdef _WIN32
+  Subprocess* subproc = subprocs_.Add("cmd /c ping -n 3 127.0.0.1 > nul");
+#else
+  Subprocess* subproc = subprocs_.Add("sleep 2");
+#endif
+  ASSERT_NE((Subprocess *) 0, subproc);
+
+  // Nothing happens within the timeout.
+  EXPECT_FALSE(subprocs_.DoWork(10));
+  EXPECT_FALSE(subproc->Done());
+  EXPECT_EQ(0u, subprocs_.finished_.size());
+
+  subprocs_.Clear();
+}
+
 TEST_F(SubprocessTest, SetWithMulti) {
   Subprocess* processes[3];
   const char* kCommands[3] = {
@@ -163,6 +163,7 @@ bool VirtualFileSystem::WriteFile(const string& path, const string& contents) {
 
 bool VirtualFileSystem::MakeDir(const string& path) {
   directories_made_.push_back(path);
+  files_[path].mtime = now_;
   return true;  // success
 }
 
@@ -233,3 +234,31 @@ void ScopedTempDir::Cleanup() {
 
   temp_dir_name_.clear();
 }
+
+#ifndef _WIN32
+ScopedStdoutCapture::ScopedStdoutCapture() {
+  fflush(stdout);
+  file_ = tmpfile();
+  saved_fd_ = dup(1);
+  if (!file_ || saved_fd_ < 0 || dup2(fileno(file_), 1) < 0)
+    Fatal("capturing stdout: %s", strerror(errno));
+}
+
+ScopedStdoutCapture::~ScopedStdoutCapture() {
+  fflush(stdout);
+  dup2(saved_fd_, 1);
+  close(saved_fd_);
+  fclose(file_);
+}
+
+string ScopedStdoutCapture::Read() {
+  fflush(stdout);
+  string output;
+  rewind(file_);
+  char buf[64 << 10];
+  size_t len;
+  while ((len = fread(buf, 1, sizeof(buf), file_)) > 0)
+    output.append(buf, len);
+  return output;
+}
+#endif
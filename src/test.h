@@ -181,4 +181,20 @@ struct ScopedTempDir {
   string temp_dir_name_;
 };
 
+#ifndef _WIN32
+/// Redirect stdout to a temporary file while in scope, so that tests can
+/// check what was printed.
+struct ScopedStdoutCapture {
+  ScopedStdoutCapture();
+  ~ScopedStdoutCapture();
+
+  /// @return everything printed since the capture started.
+  string Read();
+
+ private:
+  FILE* file_;
+  int saved_fd_;
+};
+#endif
+
 #endif // NINJA_TEST_H_
@@ -51,6 +51,12 @@
 #include <sys/sysinfo.h>
 #endif
 
+#if defined(__SSE2__) || defined(_M_X64) || \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NINJA_UTIL_SSE2
+#include <emmintrin.h>
+#endif
+
 #include "edit_distance.h"
 #include "metrics.h"
 
@@ -110,6 +116,65 @@ static bool IsPathSeparator(char c) {
 #endif
 }
 
+static const int kMaxPathComponents = 60;
+
+/// Return true if |path| is already in the form CanonicalizePath() produces
+/// and so can be left untouched: apart from leading "../" components it has
+/// no "." or ".." components, no empty components, no trailing separator
+/// and (on Windows) no backslashes.  Paths with a component that merely
+/// starts with a '.' are reported as not canonical and take the slow path.
+static bool IsCanonicalPath(const char* path, size_t len) {
+  const char* p = path;
+  const char* end = path + len;
+
+  // Leading ".." components are kept as they are.
+  while (end - p >= 3 && p[0] == '.' && p[1] == '.' && p[2] == '/')
+    p += 3;
+  if (p == end || *p == '.' || (p != path && *p == '/') || end[-1] == '/')
+    return false;
+
+  // Look for a separator followed by another separator or a '.', counting
+  // separators on the way to respect kMaxPathComponents.
+  int components = *p == '/' ? 0 : 1;
+  unsigned int prev_slash = 0;
+#ifdef NINJA_UTIL_SSE2
+  const __m128i slash_char = _mm_set1_epi8('/');
+  const __m128i dot_char = _mm_set1_epi8('.');
+#ifdef _WIN32
+  const __m128i backslash_char = _mm_set1_epi8('\\');
+#endif
+  while (end - p >= 16) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+#ifdef _WIN32
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(chunk, backslash_char)))
+      return false;
+#endif
+    unsigned int slash = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, slash_char));
+    unsigned int dot = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, dot_char));
+    // Bit i is set if byte i - 1 is a separator.
+    unsigned int after_slash = (slash << 1) | prev_slash;
+    if (after_slash & (slash | dot))
+      return false;
+    prev_slash = slash >> 15;
+    for (; slash; slash &= slash - 1)
+      ++components;
+    p += 16;
+  }
+#endif
+  for (; p < end; ++p) {
+#ifdef _WIN32
+    if (*p == '\\')
+      return false;
+#endif
+    unsigned int slash = *p == '/';
+    if (prev_slash && (slash || *p == '.'))
+      return false;
+    prev_slash = slash;
+    components += slash;
+  }
+  return components <= kMaxPathComponents;
+}
+
 bool CanonicalizePath(char* path, size_t* len, uint64_t* slash_bits,
                       string* err) {
   // WARNING: this function is performance-critical; please benchmark
@@ -120,7 +185,12 @@ bool CanonicalizePath(char* path, size_t* len, uint64_t* slash_bits,
     return false;
   }
 
-  const int kMaxPathComponents = 60;
+  // Most paths in manifests and depfiles are canonical already.
+  if (IsCanonicalPath(path, *len)) {
+    *slash_bits = 0;
+    return true;
+  }
+
   char* components[kMaxPathComponents];
   int component_count = 0;
 
@@ -362,6 +432,22 @@ int ReadFile(const string& path, string* contents, string* err) {
 #endif
 }
 
+bool ReadLine(FILE* f, string* line) {
+  line->clear();
+  char buf[4096];
+  while (fgets(buf, sizeof(buf), f)) {
+    *line += buf;
+    if ((*line)[line->size() - 1] == '\n')
+      break;
+  }
+  if (line->empty())
+    return false;
+  while (!line->empty() && ((*line)[line->size() - 1] == '\n' ||
+                            (*line)[line->size() - 1] == '\r'))
+    line->resize(line->size() - 1);
+  return true;
+}
+
 void SetCloseOnExec(int fd) {
 #ifndef _WIN32
   int flags = fcntl(fd, F_GETFD);
@@ -21,6 +21,8 @@
 #include <stdint.h>
 #endif
 
+#include <stdio.h>
+
 #include <string>
 #include <vector>
 using namespace std;
@@ -59,6 +61,11 @@ void GetWin32EscapedString(const string& input, string* result);
 /// Returns -errno and fills in \a err on error.
 int ReadFile(const string& path, string* contents, string* err);
 
+/// Read a line of any length from \a f into \a line, without the trailing
+/// newline or carriage return.
+/// @return false if the end of the file was reached before reading anything.
+bool ReadLine(FILE* f, string* line);
+
 /// Mark a file descriptor to not be inherited on exec()s.
 void SetCloseOnExec(int fd);
 
@@ -368,6 +368,39 @@ TEST(CanonicalizePath, NotNullTerminated) {
   EXPECT_EQ("file ./file bar/.", string(path));
 }
 
+TEST(CanonicalizePath, MatchesSlowPath) {
+  // Already canonical paths are returned without being rewritten.  Check
+  // that this agrees with the full algorithm, which a leading "./" forces,
+  // for paths of many shapes and lengths.
+  const char* kComponents[] = {
+    "a", "bb", "third_party", "x.h", ".hidden", ".", "..", "", "..."
+  };
+  const int kNumComponents = sizeof(kComponents) / sizeof(kComponents[0]);
+  unsigned int seed = 1;
+  for (int iteration = 0; iteration < 5000; ++iteration) {
+    string path;
+    seed = seed * 1103515245 + 12345;
+    int count = (seed >> 16) % 40 + 1;
+    for (int i = 0; i < count; ++i) {
+      seed = seed * 1103515245 + 12345;
+      // Favor plain components so that many paths are canonical.
+      unsigned int choice = (seed >> 16) % (kNumComponents * 3);
+      if (i)
+        path += "/";
+      path += kComponents[choice < kNumComponents ? choice : choice % 3];
+    }
+    // "./" would turn absolute paths into relative ones.
+    if (path.empty() || path[0] == '/')
+      continue;
+    string fast = path, slow = "./" + path, err;
+    uint64_t fast_bits, slow_bits;
+    ASSERT_TRUE(CanonicalizePath(&slow, &slow_bits, &err));
+    ASSERT_TRUE(CanonicalizePath(&fast, &fast_bits, &err));
+    ASSERT_EQ(slow, fast);
+    ASSERT_EQ(slow_bits, fast_bits);
+  }
+}
+
 TEST(PathEscaping, TortureTest) {
   string result;
 
@@ -426,3 +459,23 @@ TEST(ElideMiddle, ElideInTheMiddle) {
   string elided = ElideMiddle(input, 10);
   EXPECT_EQ("012...789", elided);
 }
+
+TEST(ReadLine, LinesOfAnyLength) {
+  FILE* f = tmpfile();
+  ASSERT_TRUE(f);
+  string long_line(10000, 'x');
+  fprintf(f, "one\r\n\n%s\nlast", long_line.c_str());
+  rewind(f);
+
+  string line;
+  ASSERT_TRUE(ReadLine(f, &line));
+  EXPECT_EQ("one", line);
+  ASSERT_TRUE(ReadLine(f, &line));
+  EXPECT_EQ("", line);
+  ASSERT_TRUE(ReadLine(f, &line));
+  EXPECT_EQ(long_line, line);
+  ASSERT_TRUE(ReadLine(f, &line));
+  EXPECT_EQ("last", line);
+  EXPECT_FALSE(ReadLine(f, &line));
+  fclose(f);
+}